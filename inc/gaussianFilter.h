@@ -31,23 +31,275 @@
 #include "macros.h"
 #include "CL/cl.h"
 
-#define LOCAL_XRES  16
+#define LOCAL_XRES  16                        // Default work-group tile, see -localSize
 #define LOCAL_YRES  16
 
+#define MAX_KERNEL_EVENTS                 4   // Kernels enqueued by one runKernels call, at most
+
+#define MAX_FILTER_SIZE                   31
+
+/******************************************************************************
+ * Filter modes                                                               *
+ ******************************************************************************/
+#define FILTER_MODE_DIRECT                0   // TAP_SIZE x TAP_SIZE non-separable convolution
+#define FILTER_MODE_SEPARABLE             1   // Horizontal 1D pass followed by a vertical 1D pass
+#define FILTER_MODE_RECURSIVE             2   // Recursive (IIR) Gaussian, cost independent of sigma
+#define FILTER_MODE_BOX                   3   // Three box blurs of sliding sums, cost independent of sigma
+
+#define BORDER_MODE_HOST_PAD             -1   // Host pads the input with a zero border
+#define BORDER_MODE_CONSTANT              0   // Zero outside the image, handled on the device
+#define BORDER_MODE_REPLICATE             1   // Edge pixel repeated
+#define BORDER_MODE_REFLECT               2   // Mirrored, edge pixel included (dcba|abcd)
+#define BORDER_MODE_WRAP                  3   // Periodic
+
+#define OUTPUT_BOTH                       0   // Gaussian and enhanced outputs
+#define OUTPUT_GAUSSIAN                   1   // Gaussian output only, no enhance step
+#define OUTPUT_ENHANCED                   2   // Enhanced output only, the Gaussian one is not stored
+
+#define LDS_MODE_SHUFFLE                  2   // useLds: share row taps through sub-group shuffles
+
+#define SUBGROUP_EXT_NONE                 0
+#define SUBGROUP_EXT_KHR                  1   // cl_khr_subgroups + cl_khr_subgroup_shuffle
+#define SUBGROUP_EXT_INTEL                2   // cl_intel_subgroups
+
+#define FIXED_POINT_SHIFT                 16  // Fixed-point coefficients sum to 1 << FIXED_POINT_SHIFT
+
+#define MAX_PYRAMID_LEVELS                12  // Levels below the input built by the pyramid kernels
+#define PYRAMID_LDS_DIM                   64  // Levels up to this size are built from LDS by one work-group
+
+#define POINT_OP_GAMMA                    0   // x = x^e
+#define POINT_OP_LUT                      1   // x = table at x, linearly interpolated over [0, 1]
+#define POINT_OP_GAIN                     2   // x = x * gain + offset
+#define POINT_OP_CLAMP                    3   // x = clamp(x, lo, hi)
+#define MAX_POINT_OPS                     8   // Operations in the chain after the enhance step
+#define MAX_POINT_OP_PARAMS               256 // Parameters of one operation, the LUT entries
+
+#define RECURSIVE_LOCAL_SIZE              64  // Work-group size of the 1D recursive filter launches
+#define RECURSIVE_MIN_SIGMA               0.5f
+#define BOX_PASSES                        3   // Box blurs per direction of the box approximation
+#define SAT_SCAN_SIZE                     256 // Work-items of the summed-area table scans
+#define STRIP_WIDTH                       16  // Output columns of one work-item of the CPU strip kernels
+#define STRIP_ROWS                        64  // Output rows walked by one work-item of the CPU strip kernels
+
 #define GAUSSIANFILTER_KERNEL_SOURCE      "gaussianFilter.cl"
 #define GAUSSIANFILTER_KERNEL             "gaussianFilterKernel"
 #define ENHANCED_KERNEL                   "enhanceFilterKernel"
 #define COMBINED_KERNEL                   "combinedFilterKernel"
+#define GAUSSIAN_ROW_KERNEL               "gaussianRowKernel"
+#define GAUSSIAN_COL_KERNEL               "gaussianColKernel"
+#define COMBINED_SEPARABLE_KERNEL         "combinedSeparableKernel"
+#define GAUSSIANFILTER_BLOCKED_KERNEL     "gaussianFilterBlockedKernel"
+#define COMBINED_BLOCKED_KERNEL           "combinedFilterBlockedKernel"
+#define GAUSSIANFILTER_STRIP_KERNEL       "gaussianFilterStripKernel"
+#define COMBINED_STRIP_KERNEL             "combinedFilterStripKernel"
+#define GAUSSIANFILTER_PACKED_KERNEL      "gaussianFilterPackedKernel"
+#define ENHANCED_PACKED_KERNEL            "enhanceFilterPackedKernel"
+#define COMBINED_PACKED_KERNEL            "combinedFilterPackedKernel"
+#define GAUSSIANFILTER_VEC_KERNEL         "gaussianFilterVecKernel"
+#define ENHANCED_VEC_KERNEL               "enhanceFilterVecKernel"
+#define COMBINED_VEC_KERNEL               "combinedFilterVecKernel"
+#define GAUSSIANFILTER_FIXED_KERNEL       "gaussianFilterFixedKernel"
+#define COMBINED_FIXED_KERNEL             "combinedFilterFixedKernel"
+#define GAUSSIANFILTER_BORDER_KERNEL      "gaussianFilterBorderKernel"
+#define COMBINED_BORDER_KERNEL            "combinedFilterBorderKernel"
+#define GAUSSIANFILTER_FOLDED_KERNEL      "gaussianFilterFoldedKernel"
+#define COMBINED_FOLDED_KERNEL            "combinedFilterFoldedKernel"
+#define GAUSSIANFILTER_SHUFFLE_KERNEL     "gaussianFilterShuffleKernel"
+#define COMBINED_SHUFFLE_KERNEL           "combinedFilterShuffleKernel"
+#define GAUSSIANFILTER_HALF_KERNEL        "gaussianFilterHalfKernel"
+#define COMBINED_HALF_KERNEL              "combinedFilterHalfKernel"
+#define GAUSSIANFILTER_IMAGE_KERNEL       "gaussianFilterImageKernel"
+#define ENHANCED_IMAGE_KERNEL             "enhanceFilterImageKernel"
+#define COMBINED_IMAGE_KERNEL             "combinedFilterImageKernel"
+#define GAUSSIAN_RECURSIVE_ROW_KERNEL     "gaussianRecursiveRowKernel"
+#define GAUSSIAN_RECURSIVE_COL_KERNEL     "gaussianRecursiveColKernel"
+#define GAUSSIAN_BOX_ROW_KERNEL           "gaussianBoxRowKernel"
+#define GAUSSIAN_BOX_COL_KERNEL           "gaussianBoxColKernel"
+#define SAT_ROW_SCAN_KERNEL               "satRowScanKernel"
+#define SAT_COL_SCAN_KERNEL               "satColScanKernel"
+#define BOX_MEAN_KERNEL                   "boxMeanKernel"
+#define GAUSSIANFILTER_RGBA_KERNEL        "gaussianFilterRgbaKernel"
+#define ENHANCED_RGBA_KERNEL              "enhanceFilterRgbaKernel"
+#define COMBINED_RGBA_KERNEL              "combinedFilterRgbaKernel"
+#define GAUSSIANFILTER_PLANAR_KERNEL      "gaussianFilterPlanarKernel"
+#define ENHANCED_PLANAR_KERNEL            "enhanceFilterPlanarKernel"
+#define COMBINED_PLANAR_KERNEL            "combinedFilterPlanarKernel"
+#define GAUSSIAN_PYRAMID_KERNEL           "gaussianPyramidKernel"
+#define GAUSSIAN_PYRAMID_LDS_KERNEL       "gaussianPyramidLdsKernel"
+#define LAPLACIAN_COLLAPSE_KERNEL         "laplacianCollapseKernel"
+#define COMBINED_PERSISTENT_KERNEL        "combinedFilterPersistentKernel"
+
+/******************************************************************************
+ * One per-pixel operation of the chain applied to the enhanced output. Pixel *
+ * values are normalized to [0, 1] for the whole chain                        *
+ ******************************************************************************/
+typedef struct pointOp
+{
+    cl_int type;                // POINT_OP_*
+    cl_uint numParams;
+    cl_float params[MAX_POINT_OP_PARAMS];
+} pointOp;
+
+/******************************************************************************
+ * Rectangle of the image in pixels, a region of interest when width is not 0 *
+ ******************************************************************************/
+typedef struct roiRect
+{
+    cl_uint x;
+    cl_uint y;
+    cl_uint width;
+    cl_uint height;
+} roiRect;
+
+/******************************************************************************
+ * Structure to hold the build and launch options of the filter kernels       *
+ ******************************************************************************/
+typedef struct filterConfig
+{
+    cl_uint filtSize;
+    cl_uint bitWidth;
+    cl_int useLds;              // 0 - global reads, 1 - LDS tile, LDS_MODE_SHUFFLE - sub-group shuffles
+    cl_int useIntrinsics;
+    cl_int filterMode;
+    cl_int runCombinedKernel;
+    cl_uint rowsPerItem;        // Output rows per work-item of the direct kernels
+    cl_uint vecWidth;           // Pixels per work-item of the vectorized kernels, 1 = scalar
+    cl_float sigma;             // Gaussian sigma, <= 0 selects the default for filtSize
+    cl_uint boxRadius[BOX_PASSES];  // Radii of the box approximation, kernel arguments
+    cl_int bakeCoeff;           // Compile the coefficients into the program as constants
+    cl_int fixedPoint;          // 8-bit only: integer coefficients and uint accumulation
+    cl_int useImage;            // Input is an unpadded image2d_t read through a sampler
+    cl_int borderMode;          // BORDER_MODE_*, anything but HOST_PAD uploads the input unpadded
+    cl_uint localXRes;          // Work-group tile width of the 2D kernels
+    cl_uint localYRes;          // Work-group tile height of the 2D kernels
+    cl_int foldCoeff;           // Coefficients are symmetric, add mirrored pixels before multiplying
+    cl_int halfPrecision;       // 8-bit only: half coefficients and accumulation, needs cl_khr_fp16
+    cl_uint channels;           // 1 - single channel, 3 - RGB, 4 - RGBA
+    cl_int planar;              // Channels stored as separate planes instead of interleaved
+    cl_uint pyramidLevels;      // Gaussian pyramid levels built below the input, 0 - none
+    cl_int multiScale;          // Enhance through the Laplacian pyramid of the pyramid levels
+    cl_float detailGain[MAX_PYRAMID_LEVELS];  // Gain of Laplacian level 0 (finest) and up
+    cl_uint numPointOps;        // Operations generated into the enhance step, 0 - none
+    pointOp pointOps[MAX_POINT_OPS];
+    cl_int strip;               // Sliding-window strip kernels, chosen for CPU devices
+    cl_int persistent;          // Combined kernel as one work-group per compute unit pulling tiles
+    cl_uint persistentGroups;   // Work-groups of the persistent launch, the device compute units
+    cl_uint frames;             // Frames stored one after another in the input and output buffers
+    cl_int batched;             // Frames filtered by one 3D launch of the direct kernels
+    cl_uint satRadius;          // Box-mean radius over the summed-area table, 0 - none
+    cl_int radiusMap;           // Per-pixel radius map, 255 is satRadius
+    cl_uint outputSelect;       // OUTPUT_BOTH, OUTPUT_GAUSSIAN or OUTPUT_ENHANCED
+    roiRect roi;                // Outputs computed by the direct kernels, width 0 - whole image
+    const cl_float *filterCoeff;    // filtSize x filtSize coefficients, used when baking
+    const cl_float *filterCoeff1D;  // filtSize 1D coefficients, used when baking
+    const cl_uint *filterCoeffFixed;// filtSize x filtSize fixed-point coefficients, used when baking
+} filterConfig;
+
+/******************************************************************************
+ * Structure to hold the filter kernels                                       *
+ ******************************************************************************/
+typedef struct filterKernels
+{
+    cl_kernel gaussianKernel;   // Register-blocked variant when rowsPerItem > 1,
+                                // vectorized variant when vecWidth > 1
+    cl_kernel enhancedKernel;
+    cl_kernel combinedKernel;   // Fused separable kernel in FILTER_MODE_SEPARABLE
+    cl_kernel rowKernel;        // Separable, recursive or box horizontal pass
+    cl_kernel colKernel;        // Separable, recursive or box vertical pass
+    cl_kernel pyramidKernel;    // One blurred and decimated pyramid level per launch
+    cl_kernel pyramidLdsKernel; // All remaining small levels from LDS in one work-group
+    cl_kernel collapseKernel;   // Expand, subtract, gain and add of one Laplacian level
+    cl_kernel satRowKernel;     // Prefix sums of the input rows
+    cl_kernel satColKernel;     // Prefix sums down the columns, completes the summed-area table
+    cl_kernel boxMeanKernel;    // Box mean of any radius from the summed-area table
+} filterKernels;
+
+/******************************************************************************
+ * Structure to hold the device buffers used by the filter kernels            *
+ ******************************************************************************/
+typedef struct filterBuffers
+{
+    cl_mem input;               // Padded input buffer, or the unpadded image with useImage
+    cl_mem gaussianOutput;
+    cl_mem enhancedOutput;
+    cl_mem filterCoeff;
+    cl_mem filterCoeff1D;
+    cl_mem rowOutput;           // Intermediate float output of the horizontal pass
+    cl_mem pyramid;             // Pyramid levels 1 to pyramidLevels, one after another
+    cl_mem collapse;            // Float collapsed levels 1 to pyramidLevels - 1, pyramid layout
+    cl_mem tileCounter;         // Next tile and finished groups of the persistent kernel
+    cl_mem boxTemp;             // Float box output between the passes of the box approximation
+    cl_mem sat;                 // Summed-area table, uint or ulong, see satIsWide
+    cl_mem radiusMap;           // uchar per-pixel radius of the box mean
+    cl_mem boxMeanOutput;
+} filterBuffers;
+
+/******************************************************************************
+ * Size and position of the pyramid levels, level 0 is the input image        *
+ ******************************************************************************/
+typedef struct pyramidLayout
+{
+    cl_uint width[MAX_PYRAMID_LEVELS + 1];
+    cl_uint height[MAX_PYRAMID_LEVELS + 1];
+    size_t base[MAX_PYRAMID_LEVELS + 1];    // First pixel of the level in the pyramid buffer
+    size_t size;                            // Pixels of all levels below the input
+} pyramidLayout;
+
+/******************************************************************************
+ * Profiling events of the kernels enqueued by one runKernels call            *
+ ******************************************************************************/
+typedef struct kernelEvents
+{
+    cl_event event[MAX_KERNEL_EVENTS];
+    cl_uint count;
+} kernelEvents;
 
 bool buildKernels(cl_context oclContext, cl_device_id oclDevice,
-                cl_kernel *gaussianFilterKernel, cl_kernel *enhancedKernel, cl_kernel *cominedKernel, 
-                cl_uint filtSize, cl_uint bitWidth,
-                cl_int useLds, cl_int useIntrinsics);
-bool setKernelArgs(cl_kernel gaussianFilterKernel, cl_kernel enhancedKernel, cl_kernel combinedKernel, 
-                   cl_mem input, cl_mem output1, cl_mem output2, cl_mem filterCoeff, cl_uint width,
-                cl_uint height, cl_uint filtSize);
-bool runKernels(cl_command_queue oclQueue, cl_kernel gaussianFilterKernel,
-                cl_kernel enhancedKernel, cl_kernel combinedKernel, cl_int runCombinedKernel, 
+                filterConfig *config, filterKernels *kernels);
+bool setKernelArgs(filterKernels *kernels, filterBuffers *buffers,
+                filterConfig *config, cl_uint width, cl_uint height);
+bool runKernels(cl_command_queue oclQueue, filterKernels *kernels,
+                filterConfig *config, cl_uint width, cl_uint height,
+                kernelEvents *events);
+bool runPyramid(cl_command_queue oclQueue, filterKernels *kernels,
+                filterBuffers *buffers, filterConfig *config,
+                cl_uint width, cl_uint height);
+bool runLaplacianEnhance(cl_command_queue oclQueue, filterKernels *kernels,
+                filterBuffers *buffers, filterConfig *config,
+                cl_uint width, cl_uint height);
+bool runBoxMean(cl_command_queue oclQueue, filterKernels *kernels,
+                filterBuffers *buffers, filterConfig *config,
+                cl_uint width, cl_uint height);
+void releaseKernels(filterKernels *kernels);
+cl_double kernelEventsTime(kernelEvents *events);
+size_t kernelsWorkGroupSize(filterKernels *kernels, cl_device_id oclDevice);
+bool deviceHasExtension(cl_device_id oclDevice, const char *extension);
+cl_int subgroupShuffleExt(cl_device_id oclDevice);
+cl_uint storedChannels(const filterConfig *config);
+cl_uint packedBits(cl_uint bitWidth);
+size_t packedRowBytes(cl_uint width, cl_uint bits);
+void packPixels(const cl_ushort *src, cl_uint count, cl_uint bits, cl_uchar *dst);
+void computePyramidLayout(cl_uint width, cl_uint height, cl_uint levels,
+                pyramidLayout *layout);
+size_t sampleIndex(const filterConfig *config, cl_uint channel, cl_uint x, cl_uint y,
                 cl_uint width, cl_uint height);
+void generateGaussianCoeff(cl_uint filtSize, cl_float sigma,
+                cl_float *coeff1D, cl_float *coeff2D);
+void computeRecursiveCoeff(cl_float sigma, cl_float4 *coeff);
+void computeBoxRadii(cl_float sigma, cl_uint *radii);
+bool satIsWide(const filterConfig *config);
+bool gaussianOutputNeeded(const filterConfig *config);
+void roiOutputRect(const filterConfig *config, cl_uint width, cl_uint height,
+                roiRect *rect);
+void roiInputRect(const filterConfig *config, cl_uint width, cl_uint height,
+                roiRect *rect);
+cl_float boxGaussianError(cl_float sigma, const cl_uint *radii);
+bool isSymmetricCoeff(cl_uint filtSize, const cl_float *coeff1D,
+                const cl_float *coeff2D);
+cl_float halfPrecisionError(cl_uint count, const cl_float *coeff, cl_float maxPixel);
+cl_float quantizeGaussianCoeff(cl_uint count, const cl_float *coeff,
+                cl_uint shift, cl_uint *fixedCoeff);
+bool parsePointOps(const char *chain, filterConfig *config);
+char *generatePointOps(const filterConfig *config);
 
 #endif
@@ -44,17 +44,6 @@
 #define GAUSSIAN_FILT_5_2    0.012259f, 0.054290f, 0.091068f, 0.054290f, 0.012259f
 #define GAUSSIAN_FILT_5_3    0.021015f, 0.091068f, 0.222416f, 0.091068f, 0.021015f
 
-#define GAUSSIAN_FILT_7_1    0.023511f, 0.023511f, 0.023511f, 0.023512f, 0.023511f, 0.023511f, 0.023511f
-#define GAUSSIAN_FILT_7_2    0.023511f, 0.023519f, 0.025592f, 0.035470f, 0.025592f, 0.023519f, 0.023511f
-#define GAUSSIAN_FILT_7_3    0.023511f, 0.025592f, 0.303353f, 0.712768f, 0.303353f, 0.025592f, 0.023511f
-#define GAUSSIAN_FILT_7_4    0.023512f, 0.035470f, 0.712768f,-5.069447f, 0.712768f, 0.035470f, 0.023512f
-
-#define GAUSSIAN_FILT_9_1    0.014223f, 0.014223f, 0.014223f, 0.014223f, 0.014223f, 0.014223f, 0.014223f, 0.014223f, 0.014223f
-#define GAUSSIAN_FILT_9_2    0.014223f, 0.014223f, 0.014223f, 0.014223f, 0.014224f, 0.014223f, 0.014223f, 0.014223f, 0.014223f
-#define GAUSSIAN_FILT_9_3    0.014223f, 0.014223f, 0.014231f, 0.016304f, 0.026182f, 0.016304f, 0.014231f, 0.014223f, 0.014223f
-#define GAUSSIAN_FILT_9_4    0.014223f, 0.014223f, 0.016304f, 0.294065f, 0.703480f, 0.294065f, 0.016304f, 0.014223f, 0.014223f
-#define GAUSSIAN_FILT_9_5    0.014223f, 0.014224f, 0.026182f, 0.703480f,-5.078736f, 0.703480f, 0.026182f, 0.014224f, 0.014223f
-
 float gaussianFilterCoeff_3x3[] = { 
     GAUSSIAN_FILT_3_1,
     GAUSSIAN_FILT_3_2,
@@ -70,24 +59,15 @@ float gaussianFilterCoeff_5x5[] = {
 };
 
 
-float gaussianFilterCoeff_7x7[] = { 
-    GAUSSIAN_FILT_7_1,
-    GAUSSIAN_FILT_7_2,  
-    GAUSSIAN_FILT_7_3,  
-    GAUSSIAN_FILT_7_4,  
-    GAUSSIAN_FILT_7_3,  
-    GAUSSIAN_FILT_7_2,  
-    GAUSSIAN_FILT_7_1};
+/****************************************************************************************
+ * 1D Gaussian coefficients used by the separable path. The 3x3 table above is the      *
+ * outer product of the 3-tap kernel; the 5-tap one is the normalized 1D Gaussian for   *
+ * sigma = 1.0.                                                                         *
+ *                                                                                      *
+ * All other filter sizes and sigmas are computed by generateGaussianCoeff.             *
+ ****************************************************************************************/
+float gaussianFilterCoeff1D_3[] = { 0.250000f, 0.500000f, 0.250000f };
 
-float gaussianFilterCoeff_9x9[] = { 
-    GAUSSIAN_FILT_9_1,
-    GAUSSIAN_FILT_9_2,  
-    GAUSSIAN_FILT_9_3,  
-    GAUSSIAN_FILT_9_4,  
-    GAUSSIAN_FILT_9_5,  
-    GAUSSIAN_FILT_9_4,  
-    GAUSSIAN_FILT_9_3,  
-    GAUSSIAN_FILT_9_2,  
-    GAUSSIAN_FILT_9_1};
+float gaussianFilterCoeff1D_5[] = { 0.054489f, 0.244201f, 0.402620f, 0.244201f, 0.054489f };
 
 #endif                                                                                   
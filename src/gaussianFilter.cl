@@ -31,6 +31,177 @@ THE POSSIBILITY OF SUCH DAMAGE.
 #define ROUND(x) ((x > 0) ? convert_ushort_rte(x) : 0)
 #endif
 
+// With BAKED_COEFF the host passes the normalized coefficients as literal
+// initializers in the build options. The unrolled tap loops then index them with
+// constants, which lets the compiler fold them into the instructions instead of
+// reading pFilter from __constant memory on every tap. With FIXED_POINT the 2D
+// coefficients are the scaled integer weights.
+#ifndef FIXED_POINT
+#define FIXED_POINT 0
+#endif
+
+#if BAKED_COEFF == 1
+#if FIXED_POINT == 1
+__constant uint cFilter2D[TAP_SIZE * TAP_SIZE] = FILTER_COEFF_2D;
+#else
+__constant float cFilter2D[TAP_SIZE * TAP_SIZE] = FILTER_COEFF_2D;
+#endif
+__constant float cFilter1D[TAP_SIZE] = FILTER_COEFF_1D;
+#define FILTER_2D(pFilter, i)   cFilter2D[i]
+#define FILTER_1D(pFilter, i)   cFilter1D[i]
+#else
+#define FILTER_2D(pFilter, i)   pFilter[i]
+#define FILTER_1D(pFilter, i)   pFilter[i]
+#endif
+
+// With POINT_OPS the host has compiled a generated pointOps(float) ahead of this
+// file: the per-pixel chain (gamma, LUTs, gain/offset, clamps) applied to the
+// enhanced value before it is saturated and stored, so it costs no extra pass.
+#ifndef POINT_OPS
+#define POINT_OPS 0
+#endif
+
+#if POINT_OPS == 1
+#define POINT_OPS_INT(v)        convert_int_sat_rte(pointOps(convert_float(v)))
+#else
+#define POINT_OPS_INT(v)        (v)
+#endif
+
+// OUTPUT_SELECT 1 keeps only the Gaussian output of the combined kernels and 2
+// only the enhanced one. The other buffer is not allocated and its argument is
+// NULL, so its stores are compiled out. 0 stores both.
+#ifndef OUTPUT_SELECT
+#define OUTPUT_SELECT 0
+#endif
+
+#if OUTPUT_SELECT == 2
+#define STORE_FILTERED(s)
+#else
+#define STORE_FILTERED(s)       s
+#endif
+
+#if OUTPUT_SELECT == 1
+#define STORE_ENHANCED(s)
+#else
+#define STORE_ENHANCED(s)       s
+#endif
+
+// With BATCH the scalar direct kernels are launched over a 3D NDRange whose
+// dimension 2 is the frame index. The frames are packed one after another in
+// the input (padded) and output buffers.
+#ifndef BATCH
+#define BATCH 0
+#endif
+
+#if BATCH == 1
+#define FRAME_IN(p, nExWidth, nHeight)  ((p) + get_global_id(2) * (nExWidth) * ((nHeight) + TAP_SIZE - 1))
+#define FRAME_OUT(p, nWidth, nHeight)   ((p) + get_global_id(2) * (nWidth) * (nHeight))
+#else
+#define FRAME_IN(p, nExWidth, nHeight)  (p)
+#define FRAME_OUT(p, nWidth, nHeight)   (p)
+#endif
+
+// With ROI_END_X/Y the direct kernels are launched at the region of interest
+// through the global work offset, rounded up to the work-group tile. The
+// work-items past the region end store nothing, so the device outputs outside
+// it keep their contents.
+#ifndef ROI_END_X
+#define ROI_END_X 0
+#define ROI_END_Y 0
+#endif
+
+#if ROI_END_X > 0
+#define OUT_OF_ROI(ix, iy)      ((ix) >= ROI_END_X || (iy) >= ROI_END_Y)
+#else
+#define OUT_OF_ROI(ix, iy)      0
+#endif
+
+// With FOLD_COEFF the host has found the coefficients symmetric about the centre
+// row and column. Mirrored pixels are then added before the multiply, so a 1D pass
+// needs TAP_SIZE/2 + 1 MACs and a 2D window (TAP_SIZE/2 + 1)^2.
+#ifndef FOLD_COEFF
+#define FOLD_COEFF 0
+#endif
+
+#if USE_INTRINSICS == 1
+#define FOLD_MAD(a, b, c)   mad(convert_float(a), (b), (c))
+#else
+#define FOLD_MAD(a, b, c)   ((a) * (b) + (c))
+#endif
+
+// BORDER_MODE -1 means the host padded the input with a zero border. Modes 0 to
+// 3 (constant zero, replicate, reflect, wrap) are handled by the border kernels
+// on an unpadded input, where nExWidth equals nWidth.
+#ifndef BORDER_MODE
+#define BORDER_MODE -1
+#endif
+
+#if BORDER_MODE == -1
+#define INPUT_OFFSET    (TAP_SIZE/2)
+#else
+#define INPUT_OFFSET    0
+#endif
+
+// The LDS kernels stage the work-group's LOCAL_XRES x LOCAL_YRES tile plus its
+// TAP_SIZE - 1 halo in local memory. Rows are TILE_STRIDE pixels apart: the row
+// width rounded up to whole 32-bit banks, plus one bank when that count is even.
+// Vertically adjacent work-items of a wavefront then start in different banks.
+#if USE_LDS == 1
+
+#define TILE_XRES       (LOCAL_XRES + TAP_SIZE - 1)
+#define TILE_YRES       (LOCAL_YRES + TAP_SIZE - 1)
+#define PIX_PER_BANK    (32 / PIX_WIDTH)
+#define TILE_STRIDE     ((((TILE_XRES + PIX_PER_BANK - 1) / PIX_PER_BANK) | 1) * PIX_PER_BANK)
+#define TILE_VEC        4   // Pixels per load, matches vload4/vstore4 below
+
+// loadTile copies the tile and halo of the work-group into pTile. The region is
+// cut into TILE_VEC pixel chunks that are dealt out to the work-items in row-major
+// order, so consecutive work-items issue consecutive vector loads and any halo
+// size is covered. Pixels outside the padded image are not read; the outputs
+// that would use them are never stored.
+void loadTile(
+    __global T1 *pIBuf,      // Padded input buffer of type T1
+    __local T1 *pTile,       // TILE_STRIDE x TILE_YRES local buffer
+    uint nExWidth,           // Padded image width in pixels
+    uint nExHeight           // Padded image height in pixels
+    )
+{
+    const int chunks = (TILE_XRES + TILE_VEC - 1) / TILE_VEC;
+    int lid = get_local_id(1) * LOCAL_XRES + get_local_id(0);
+
+    // First work-item of the group, the launch may start at a global work offset
+    uint start_col = get_global_id(0) - get_local_id(0);// image is padded
+    uint start_row = get_global_id(1) - get_local_id(1);
+
+    for (int k = lid; k < chunks * TILE_YRES; k += LOCAL_XRES * LOCAL_YRES)
+    {
+        int r = k / chunks;
+        int c = (k - r * chunks) * TILE_VEC;
+        uint row = start_row + r;
+        uint col = start_col + c;
+
+        if (row >= nExHeight)
+            break;
+
+        __global T1 *pSrc = pIBuf + row * nExWidth + col;
+        __local T1 *pDst = pTile + r * TILE_STRIDE + c;
+
+        if (c + TILE_VEC <= TILE_XRES && col + TILE_VEC <= nExWidth)
+        {
+            vstore4(vload4(0, pSrc), 0, pDst);
+        }
+        else
+        {
+            for (int x = 0; x < TILE_VEC && c + x < TILE_XRES && col + x < nExWidth; x++)
+                pDst[x] = pSrc[x];
+        }
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+#endif
+
 // gaussianFilterKernel implements a non-separable convolution filter.
 __kernel 
 __attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
@@ -46,8 +217,18 @@ void gaussianFilterKernel(
     uint ix = get_global_id(0);
     uint iy = get_global_id(1);
 
+    // Frame get_global_id(2) of a batched launch
+    pIBuf = FRAME_IN(pIBuf, nExWidth, nHeight);
+    pFilterOBuf = FRAME_OUT(pFilterOBuf, nWidth, nHeight);
+
+#if USE_LDS == 1
+    // Every work-item takes part in the tile load, none may return before it
+    __local T1 local_input[TILE_STRIDE * TILE_YRES];
+    loadTile(pIBuf, local_input, nExWidth, nHeight + TAP_SIZE - 1);
+#endif
+
     // Process only if pIBuf[ix,iy] is within valid bounds.
-    if (ix >= nWidth || iy >= nHeight) return;
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
 
     uint Pos = iy * nExWidth + ix;
     T1 pix_val;
@@ -55,48 +236,9 @@ void gaussianFilterKernel(
 
     float nSum = 0.0f;
     float tVal = 0.0f;
-    
-    /***************************************************************************************
-    * If using LDS, get the data to local memory. Else, get the global memory indices ready 
-    ***************************************************************************************/
 
 #if USE_LDS == 1
-
-    __local T1 local_input[(LOCAL_XRES + TAP_SIZE - 1) * (LOCAL_YRES + TAP_SIZE - 1)];
-
-    int lid_x = get_local_id(0);
-    int lid_y = get_local_id(1);
-    
-    int tile_xres = (LOCAL_XRES + TAP_SIZE - 1);
-    int tile_yres = (LOCAL_YRES + TAP_SIZE - 1);
-
-    int start_col = get_group_id(0) * LOCAL_XRES;// image is padded
-    int start_row = get_group_id(1) * LOCAL_YRES; 
-    Pos = (lid_y * tile_xres) + lid_x;
-    
-    /* Get input for a tile in local memory */
-    //First 16X16
-    local_input[lid_y * (LOCAL_XRES + TAP_SIZE - 1) + lid_x] = pIBuf[(start_row + lid_y) * nExWidth + (start_col + lid_x)];
-
-    //16X8 at the y-end of the tile
-    if (lid_y < (TAP_SIZE - 1))
-    {
-        local_input[(LOCAL_YRES + lid_y) * (LOCAL_XRES + TAP_SIZE - 1) + lid_x] = pIBuf[(start_row + lid_y + LOCAL_YRES) * nExWidth + (start_col + lid_x)];
-    }
-
-    //8X16 at the x-end of the tile
-    if (lid_x < (TAP_SIZE - 1))
-    {
-        local_input[lid_y * (LOCAL_XRES + TAP_SIZE - 1) + (lid_x + LOCAL_XRES)] = pIBuf[(start_row + lid_y) * nExWidth + (start_col + lid_x + LOCAL_XRES)];
-    }
-
-    //Right-most 8X8
-    if (lid_x < (TAP_SIZE - 1) && lid_y < (TAP_SIZE - 1))
-    {
-        local_input[(LOCAL_YRES + lid_y) * (LOCAL_XRES + TAP_SIZE - 1) + (lid_x + LOCAL_XRES)] = pIBuf[(start_row + lid_y + LOCAL_YRES) * nExWidth + (start_col + lid_x + LOCAL_XRES)];
-    }
-
-    barrier(CLK_LOCAL_MEM_FENCE);
+    Pos = get_local_id(1) * TILE_STRIDE + get_local_id(0);
 #endif
 
     for (uint i=0; i<TAP_SIZE; i++)
@@ -111,14 +253,14 @@ void gaussianFilterKernel(
 #endif
             filter_offset = i*TAP_SIZE+j;
 #if USE_INTRINSICS == 1
-            nSum = mad(convert_float(pix_val), pFilter[filter_offset++], nSum);                        
+            nSum = mad(convert_float(pix_val), FILTER_2D(pFilter, filter_offset++), nSum);                        
 #else            
-            tVal = pix_val * pFilter[filter_offset++];
+            tVal = pix_val * FILTER_2D(pFilter, filter_offset++);
             nSum = tVal + nSum;
 #endif
         }
 #if USE_LDS == 1
-        Pos += tile_xres - TAP_SIZE;
+        Pos += TILE_STRIDE - TAP_SIZE;
 #else
         Pos += nExWidth - TAP_SIZE;
 #endif
@@ -142,14 +284,19 @@ void enhanceFilterKernel(
     uint ix = get_global_id(0);
     uint iy = get_global_id(1);
 
+    // Frame get_global_id(2) of a batched launch
+    pIBuf = FRAME_IN(pIBuf, nExWidth, nHeight);
+    pGaussianFilterBuf = FRAME_OUT(pGaussianFilterBuf, nWidth, nHeight);
+    pEnhanceOBuf = FRAME_OUT(pEnhanceOBuf, nWidth, nHeight);
+
     // Process only if pIBuf[ix,iy] is within valid bounds.
-    if (ix >= nWidth || iy >= nHeight) return;
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
 
-    T1 input_val = pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+    T1 input_val = pIBuf[(iy + INPUT_OFFSET) * nExWidth + (ix + INPUT_OFFSET)];
     T1 filtered_val = pGaussianFilterBuf[iy * nWidth + ix];;
     
     //Enhance image
-    int enhanced_val = input_val + (input_val - filtered_val);
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
     
 #if PIX_WIDTH == 8
     enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
@@ -180,8 +327,19 @@ void combinedFilterKernel(
     uint ix = get_global_id(0);
     uint iy = get_global_id(1);
 
+    // Frame get_global_id(2) of a batched launch
+    pIBuf = FRAME_IN(pIBuf, nExWidth, nHeight);
+    pFilterOBuf = FRAME_OUT(pFilterOBuf, nWidth, nHeight);
+    pEnhanceOBuf = FRAME_OUT(pEnhanceOBuf, nWidth, nHeight);
+
+#if USE_LDS == 1
+    // Every work-item takes part in the tile load, none may return before it
+    __local T1 local_input[TILE_STRIDE * TILE_YRES];
+    loadTile(pIBuf, local_input, nExWidth, nHeight + TAP_SIZE - 1);
+#endif
+
     // Process only if pIBuf[ix,iy] is within valid bounds.
-    if (ix >= nWidth || iy >= nHeight) return;
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
 
     uint Pos = iy * nExWidth + ix;
     T1 pix_val;
@@ -192,47 +350,9 @@ void combinedFilterKernel(
 
     T1 input_val = pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
     T1 filtered_val;
-    
-    /***************************************************************************************
-    * If using LDS, get the data to local memory. Else, get the global memory indices ready 
-    ***************************************************************************************/
-#if USE_LDS == 1
-
-    __local T1 local_input[(LOCAL_XRES + TAP_SIZE - 1) * (LOCAL_YRES + TAP_SIZE - 1)];
-
-    int lid_x = get_local_id(0);
-    int lid_y = get_local_id(1);
-    
-    int tile_xres = (LOCAL_XRES + TAP_SIZE - 1);
-    int tile_yres = (LOCAL_YRES + TAP_SIZE - 1);
-
-    int start_col = get_group_id(0) * LOCAL_XRES;// image is padded
-    int start_row = get_group_id(1) * LOCAL_YRES; 
-    Pos = (lid_y * tile_xres) + lid_x;
-    
-    /* Get input for a tile in local memory */
-    //First 16X16
-    local_input[lid_y * (LOCAL_XRES + TAP_SIZE - 1) + lid_x] = pIBuf[(start_row + lid_y) * nExWidth + (start_col + lid_x)];
-
-    //16X8 at the y-end of the tile
-    if (lid_y < (TAP_SIZE - 1))
-    {
-        local_input[(LOCAL_YRES + lid_y) * (LOCAL_XRES + TAP_SIZE - 1) + lid_x] = pIBuf[(start_row + lid_y + LOCAL_YRES) * nExWidth + (start_col + lid_x)];
-    }
-
-    //8X16 at the x-end of the tile
-    if (lid_x < (TAP_SIZE - 1))
-    {
-        local_input[lid_y * (LOCAL_XRES + TAP_SIZE - 1) + (lid_x + LOCAL_XRES)] = pIBuf[(start_row + lid_y) * nExWidth + (start_col + lid_x + LOCAL_XRES)];
-    }
-
-    //Right-most 8X8
-    if (lid_x < (TAP_SIZE - 1) && lid_y < (TAP_SIZE - 1))
-    {
-        local_input[(LOCAL_YRES + lid_y) * (LOCAL_XRES + TAP_SIZE - 1) + (lid_x + LOCAL_XRES)] = pIBuf[(start_row + lid_y + LOCAL_YRES) * nExWidth + (start_col + lid_x + LOCAL_XRES)];
-    }
 
-    barrier(CLK_LOCAL_MEM_FENCE);
+#if USE_LDS == 1
+    Pos = get_local_id(1) * TILE_STRIDE + get_local_id(0);
 #endif
 
     for (uint i=0; i<TAP_SIZE; i++)
@@ -247,14 +367,14 @@ void combinedFilterKernel(
 #endif
             filter_offset = i*TAP_SIZE+j;
 #if USE_INTRINSICS == 1
-            nSum = mad(convert_float(pix_val), pFilter[filter_offset++], nSum);                        
+            nSum = mad(convert_float(pix_val), FILTER_2D(pFilter, filter_offset++), nSum);                        
 #else            
-            tVal = pix_val * pFilter[filter_offset++];
+            tVal = pix_val * FILTER_2D(pFilter, filter_offset++);
             nSum = tVal + nSum;
 #endif
         }
 #if USE_LDS == 1
-        Pos += tile_xres - TAP_SIZE;
+        Pos += TILE_STRIDE - TAP_SIZE;
 #else
         Pos += nExWidth - TAP_SIZE;
 #endif
@@ -265,7 +385,7 @@ void combinedFilterKernel(
     filtered_val = ROUND(nSum);
     
     //Enhance image
-    int enhanced_val = input_val + (input_val - filtered_val);
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
     
 #if PIX_WIDTH == 8
     enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
@@ -275,7 +395,2605 @@ void combinedFilterKernel(
     enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
 #endif
 
-    pFilterOBuf[iy * nWidth + ix] = filtered_val;
-    pEnhanceOBuf[iy * nWidth + ix] = enhanced_val;
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = enhanced_val);
+
+}
+
+
+// gaussianRowKernel is the horizontal pass of the separable filter. It runs over
+// all nHeight + TAP_SIZE - 1 padded rows so that the vertical pass has its halo.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianRowKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global float *pRowOBuf,// 1: Horizontal pass output, nWidth x (nHeight + TAP_SIZE - 1)
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: 1D filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight + TAP_SIZE - 1) return;
+
+    uint Pos = iy * nExWidth + ix;
+    float nSum = 0.0f;
+
+#if FOLD_COEFF == 1
+    #pragma unroll
+    for (uint j=0; j<TAP_SIZE/2; j++)
+        nSum = FOLD_MAD(pIBuf[Pos + j] + pIBuf[Pos + TAP_SIZE - 1 - j], FILTER_1D(pFilter, j), nSum);
+    nSum = FOLD_MAD(pIBuf[Pos + TAP_SIZE/2], FILTER_1D(pFilter, TAP_SIZE/2), nSum);
+#else
+    #pragma unroll TAP_SIZE
+    for (uint j=0; j<TAP_SIZE; j++,Pos++)
+    {
+#if USE_INTRINSICS == 1
+        nSum = mad(convert_float(pIBuf[Pos]), FILTER_1D(pFilter, j), nSum);
+#else
+        nSum = pIBuf[Pos] * FILTER_1D(pFilter, j) + nSum;
+#endif
+    }
+#endif
+
+    pRowOBuf[iy * nWidth + ix] = nSum;
+}
+
+// gaussianColKernel is the vertical pass of the separable filter.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianColKernel(
+    __global float *pRowIBuf,// 0: Horizontal pass output, nWidth x (nHeight + TAP_SIZE - 1)
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    __constant float *pFilter// 4: 1D filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    uint Pos = iy * nWidth + ix;
+    float nSum = 0.0f;
+
+#if FOLD_COEFF == 1
+    #pragma unroll
+    for (uint i=0; i<TAP_SIZE/2; i++)
+        nSum = FOLD_MAD(pRowIBuf[Pos + i * nWidth] + pRowIBuf[Pos + (TAP_SIZE - 1 - i) * nWidth],
+                        FILTER_1D(pFilter, i), nSum);
+    nSum = FOLD_MAD(pRowIBuf[Pos + (TAP_SIZE/2) * nWidth], FILTER_1D(pFilter, TAP_SIZE/2), nSum);
+#else
+    #pragma unroll TAP_SIZE
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+#if USE_INTRINSICS == 1
+        nSum = mad(pRowIBuf[Pos], FILTER_1D(pFilter, i), nSum);
+#else
+        nSum = pRowIBuf[Pos] * FILTER_1D(pFilter, i) + nSum;
+#endif
+        Pos += nWidth;
+    }
+#endif
+
+    pFilterOBuf[iy * nWidth + ix] = ROUND(nSum);
+}
+
+// combinedSeparableKernel fuses both passes of the separable filter with the
+// enhance filter. The horizontal pass over the tile and its TAP_SIZE - 1 halo
+// rows is kept in local memory, so a pixel costs 2 * TAP_SIZE MACs.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedSeparableKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,      // 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,      // 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: 1D filter coefficients of type float
+    )
+{
+    __local float row_sums[(LOCAL_YRES + TAP_SIZE - 1) * LOCAL_XRES];
+
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    int lid_x = get_local_id(0);
+    int lid_y = get_local_id(1);
+
+    uint start_row = get_group_id(1) * LOCAL_YRES;// image is padded
+    uint nExHeight = nHeight + TAP_SIZE - 1;
+
+    /***************************************************************************************
+    * Horizontal pass. There is no early return before the barrier, work-items outside the
+    * image just store zero.
+    ***************************************************************************************/
+    for (int r = lid_y; r < (LOCAL_YRES + TAP_SIZE - 1); r += LOCAL_YRES)
+    {
+        uint row = start_row + r;
+        float nSum = 0.0f;
 
+        if (ix < nWidth && row < nExHeight)
+        {
+            uint Pos = row * nExWidth + ix;
+
+#if FOLD_COEFF == 1
+            #pragma unroll
+            for (uint j=0; j<TAP_SIZE/2; j++)
+                nSum = FOLD_MAD(pIBuf[Pos + j] + pIBuf[Pos + TAP_SIZE - 1 - j], FILTER_1D(pFilter, j), nSum);
+            nSum = FOLD_MAD(pIBuf[Pos + TAP_SIZE/2], FILTER_1D(pFilter, TAP_SIZE/2), nSum);
+#else
+            #pragma unroll TAP_SIZE
+            for (uint j=0; j<TAP_SIZE; j++,Pos++)
+            {
+#if USE_INTRINSICS == 1
+                nSum = mad(convert_float(pIBuf[Pos]), FILTER_1D(pFilter, j), nSum);
+#else
+                nSum = pIBuf[Pos] * FILTER_1D(pFilter, j) + nSum;
+#endif
+            }
+#endif
+        }
+        row_sums[r * LOCAL_XRES + lid_x] = nSum;
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    /***************************************************************************************
+    * Vertical pass from local memory
+    ***************************************************************************************/
+    int Pos = lid_y * LOCAL_XRES + lid_x;
+    float nSum = 0.0f;
+
+#if FOLD_COEFF == 1
+    #pragma unroll
+    for (uint i=0; i<TAP_SIZE/2; i++)
+        nSum = FOLD_MAD(row_sums[Pos + i * LOCAL_XRES] + row_sums[Pos + (TAP_SIZE - 1 - i) * LOCAL_XRES],
+                        FILTER_1D(pFilter, i), nSum);
+    nSum = FOLD_MAD(row_sums[Pos + (TAP_SIZE/2) * LOCAL_XRES], FILTER_1D(pFilter, TAP_SIZE/2), nSum);
+#else
+    #pragma unroll TAP_SIZE
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+#if USE_INTRINSICS == 1
+        nSum = mad(row_sums[Pos], FILTER_1D(pFilter, i), nSum);
+#else
+        nSum = row_sums[Pos] * FILTER_1D(pFilter, i) + nSum;
+#endif
+        Pos += LOCAL_XRES;
+    }
+#endif
+
+    T1 input_val = pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+    T1 filtered_val = ROUND(nSum);
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+    enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+    enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = enhanced_val);
+}
+
+
+#ifndef ROWS_PER_ITEM
+#define ROWS_PER_ITEM 1
+#endif
+
+// convolveBlock filters a column of ROWS_PER_ITEM vertically adjacent pixels
+// starting at (ix, iy). Each of the ROWS_PER_ITEM + TAP_SIZE - 1 input rows of the
+// window is loaded into registers once and accumulated into every output whose
+// window covers it. With the loops unrolled the row/output pairing is resolved at
+// compile time. Rows past the padded image are clamped to its last row, the
+// results for them are never stored.
+void convolveBlock(
+    __global T1 *pIBuf,      // Input buffer of type T1
+    uint nHeight,            // Image height in pixels
+    uint nExWidth,           // Padded image width in pixels
+    __constant float *pFilter,// Filter coefficients of type float
+    uint ix,                 // Output column
+    uint iy,                 // First output row of the block
+    float *nSum              // ROWS_PER_ITEM filtered outputs
+    )
+{
+    T1 row_val[TAP_SIZE];
+    uint last_row = nHeight + TAP_SIZE - 2;
+
+    #pragma unroll
+    for (int k = 0; k < ROWS_PER_ITEM; k++)
+        nSum[k] = 0.0f;
+
+    #pragma unroll
+    for (int r = 0; r < ROWS_PER_ITEM + TAP_SIZE - 1; r++)
+    {
+        uint Pos = min(iy + r, last_row) * nExWidth + ix;
+
+        #pragma unroll TAP_SIZE
+        for (int j = 0; j < TAP_SIZE; j++)
+            row_val[j] = pIBuf[Pos + j];
+
+        #pragma unroll
+        for (int k = 0; k < ROWS_PER_ITEM; k++)
+        {
+            int i = r - k;  // Filter row that input row r contributes to for output k
+            if (i >= 0 && i < TAP_SIZE)
+            {
+                #pragma unroll TAP_SIZE
+                for (int j = 0; j < TAP_SIZE; j++)
+                {
+#if USE_INTRINSICS == 1
+                    nSum[k] = mad(convert_float(row_val[j]), FILTER_2D(pFilter, i * TAP_SIZE + j), nSum[k]);
+#else
+                    nSum[k] = row_val[j] * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum[k];
+#endif
+                }
+            }
+        }
+    }
 }
+
+// gaussianFilterBlockedKernel is gaussianFilterKernel with ROWS_PER_ITEM outputs
+// per work-item, the NDRange is shrunk by ROWS_PER_ITEM in y.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterBlockedKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,      // 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1) * ROWS_PER_ITEM;
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    float nSum[ROWS_PER_ITEM];
+    convolveBlock(pIBuf, nHeight, nExWidth, pFilter, ix, iy, nSum);
+
+    #pragma unroll
+    for (int k = 0; k < ROWS_PER_ITEM; k++)
+    {
+        if (iy + k < nHeight)
+            pFilterOBuf[(iy + k) * nWidth + ix] = ROUND(nSum[k]);
+    }
+}
+
+// combinedFilterBlockedKernel is combinedFilterKernel with ROWS_PER_ITEM outputs
+// per work-item, the NDRange is shrunk by ROWS_PER_ITEM in y.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterBlockedKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,      // 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,      // 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1) * ROWS_PER_ITEM;
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    float nSum[ROWS_PER_ITEM];
+    convolveBlock(pIBuf, nHeight, nExWidth, pFilter, ix, iy, nSum);
+
+    #pragma unroll
+    for (int k = 0; k < ROWS_PER_ITEM; k++)
+    {
+        uint y = iy + k;
+        if (y >= nHeight) break;
+
+        T1 input_val = pIBuf[(y + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+        T1 filtered_val = ROUND(nSum[k]);
+
+        //Enhance image
+        int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+        enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+        enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+        enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+        enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+        STORE_FILTERED(pFilterOBuf[y * nWidth + ix] = filtered_val);
+        STORE_ENHANCED(pEnhanceOBuf[y * nWidth + ix] = enhanced_val);
+    }
+}
+
+#ifndef STRIP
+#define STRIP 0
+#endif
+
+#if STRIP == 1
+// The strip kernels suit CPU devices, where a work-item is a loop iteration and
+// not a SIMD lane. Each work-item walks down STRIP_WIDTH columns for STRIP_ROWS
+// output rows and keeps the last TAP_SIZE input rows of its strip in a private
+// ring, so every input pixel of the strip is loaded once. Each step loads one
+// row into the oldest slot and emits one STRIP_WIDTH output segment. The NDRange
+// is (nWidth / STRIP_WIDTH, nHeight / STRIP_ROWS) rounded up, the work-group
+// size is left to the runtime.
+#define STRIP_SPAN (STRIP_WIDTH + TAP_SIZE - 1)
+
+void stripLoadRow(
+    __global T1 *pIBuf,      // Input buffer of type T1
+    uint nExWidth,           // Padded image width in pixels
+    uint ix,                 // First column of the strip
+    uint y,                  // Padded input row
+    uint nSpan,              // Valid columns, the strip width plus the halo
+    float *pRow              // Ring slot of STRIP_SPAN pixels
+    )
+{
+    __global T1 *pRowIBuf = pIBuf + y * nExWidth + ix;
+
+    #pragma unroll
+    for (int j = 0; j < STRIP_SPAN; j++)
+        pRow[j] = (j < nSpan) ? convert_float(pRowIBuf[j]) : 0.0f;
+}
+
+// Filters one output segment from the ring. Slot nHead holds the top row of the
+// window, the inner loop runs along the segment so the CPU compiler vectorizes it.
+void stripConvolve(
+    float ring[TAP_SIZE][STRIP_SPAN],// TAP_SIZE input rows of the strip
+    uint nHead,              // Slot of the top row of the window
+    __constant float *pFilter,// Filter coefficients of type float
+    float *nSum              // STRIP_WIDTH filtered outputs
+    )
+{
+    #pragma unroll
+    for (int x = 0; x < STRIP_WIDTH; x++)
+        nSum[x] = 0.0f;
+
+    for (int i = 0; i < TAP_SIZE; i++)
+    {
+        uint slot = (nHead + i) % TAP_SIZE;
+
+        #pragma unroll TAP_SIZE
+        for (int j = 0; j < TAP_SIZE; j++)
+        {
+            float coeff = FILTER_2D(pFilter, i * TAP_SIZE + j);
+
+            #pragma unroll
+            for (int x = 0; x < STRIP_WIDTH; x++)
+            {
+#if USE_INTRINSICS == 1
+                nSum[x] = mad(ring[slot][x + j], coeff, nSum[x]);
+#else
+                nSum[x] = ring[slot][x + j] * coeff + nSum[x];
+#endif
+            }
+        }
+    }
+}
+
+// gaussianFilterStripKernel is gaussianFilterKernel for CPU devices, see above.
+__kernel 
+void gaussianFilterStripKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0) * STRIP_WIDTH;
+    uint iy = get_global_id(1) * STRIP_ROWS;
+
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    uint nCols = min((uint)STRIP_WIDTH, nWidth - ix);
+    uint nRows = min((uint)STRIP_ROWS, nHeight - iy);
+    float ring[TAP_SIZE][STRIP_SPAN];
+    float nSum[STRIP_WIDTH];
+
+    // Prime the ring with the rows above the first output row
+    for (int r = 0; r < TAP_SIZE - 1; r++)
+        stripLoadRow(pIBuf, nExWidth, ix, iy + r, nCols + TAP_SIZE - 1, ring[r]);
+
+    for (uint k = 0; k < nRows; k++)
+    {
+        stripLoadRow(pIBuf, nExWidth, ix, iy + k + TAP_SIZE - 1, nCols + TAP_SIZE - 1,
+                        ring[(k + TAP_SIZE - 1) % TAP_SIZE]);
+        stripConvolve(ring, k % TAP_SIZE, pFilter, nSum);
+
+        __global T1 *pRowOBuf = pFilterOBuf + (iy + k) * nWidth + ix;
+        for (uint x = 0; x < nCols; x++)
+            pRowOBuf[x] = ROUND(nSum[x]);
+    }
+}
+
+// combinedFilterStripKernel is combinedFilterKernel for CPU devices. The input
+// pixel of the enhance step is taken from the centre row of the ring.
+__kernel 
+void combinedFilterStripKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0) * STRIP_WIDTH;
+    uint iy = get_global_id(1) * STRIP_ROWS;
+
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    uint nCols = min((uint)STRIP_WIDTH, nWidth - ix);
+    uint nRows = min((uint)STRIP_ROWS, nHeight - iy);
+    float ring[TAP_SIZE][STRIP_SPAN];
+    float nSum[STRIP_WIDTH];
+
+    // Prime the ring with the rows above the first output row
+    for (int r = 0; r < TAP_SIZE - 1; r++)
+        stripLoadRow(pIBuf, nExWidth, ix, iy + r, nCols + TAP_SIZE - 1, ring[r]);
+
+    for (uint k = 0; k < nRows; k++)
+    {
+        stripLoadRow(pIBuf, nExWidth, ix, iy + k + TAP_SIZE - 1, nCols + TAP_SIZE - 1,
+                        ring[(k + TAP_SIZE - 1) % TAP_SIZE]);
+        stripConvolve(ring, k % TAP_SIZE, pFilter, nSum);
+
+        uint centre = (k + TAP_SIZE/2) % TAP_SIZE;
+        uint OutPos = (iy + k) * nWidth + ix;
+        for (uint x = 0; x < nCols; x++)
+        {
+            T1 input_val = (T1)ring[centre][x + TAP_SIZE/2];
+            T1 filtered_val = ROUND(nSum[x]);
+
+            //Enhance image
+            int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+            enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+            enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+            enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+            enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+            STORE_FILTERED(pFilterOBuf[OutPos + x] = filtered_val);
+            STORE_ENHANCED(pEnhanceOBuf[OutPos + x] = enhanced_val);
+        }
+    }
+}
+#endif
+
+#ifndef PACKED_BITS
+#define PACKED_BITS 0
+#endif
+
+#if PACKED_BITS > 0
+// The packed kernels read 10 or 12 bit input straight from the bitstream the
+// camera delivers: pixel k of a row takes bits k * PACKED_BITS onwards, counted
+// from bit 0 of the first byte, and each padded row starts on a byte. Outputs
+// are ushort (PIX_WIDTH is the packed width, so T1 is ushort).
+#define PACKED_PITCH(nExWidth)  (((nExWidth) * PACKED_BITS + 7) / 8)
+#define PACKED_MASK             ((1u << PACKED_BITS) - 1)
+#define PACKED_SPAN             ((TAP_SIZE * PACKED_BITS + 7) / 8 + 1)
+
+// A 10 or 12 bit pixel spans at most two bytes, and the byte after the first one
+// always holds some of its bits, so no read goes past the end of the row.
+uint unpackPixel(
+    __global const uchar *pRow,// Packed row
+    uint x                   // Pixel column
+    )
+{
+    uint bit = x * PACKED_BITS;
+    uint word = pRow[bit >> 3] | ((uint)pRow[(bit >> 3) + 1] << 8);
+    return (word >> (bit & 7)) & PACKED_MASK;
+}
+
+// unpackRow loads the bytes of TAP_SIZE pixels from column x once and unpacks
+// them in registers.
+void unpackRow(
+    __global const uchar *pRow,// Packed row
+    uint x,                  // First pixel column
+    float *pix               // TAP_SIZE unpacked pixels
+    )
+{
+    uchar bytes[PACKED_SPAN];
+    uint first = (x * PACKED_BITS) >> 3;
+    uint last = ((x + TAP_SIZE) * PACKED_BITS - 1) >> 3;
+
+    #pragma unroll
+    for (uint k = 0; k < PACKED_SPAN; k++)
+        bytes[k] = (first + k <= last) ? pRow[first + k] : 0;
+
+    #pragma unroll TAP_SIZE
+    for (uint j = 0; j < TAP_SIZE; j++)
+    {
+        uint bit = (x + j) * PACKED_BITS - first * 8;
+        uint word = bytes[bit >> 3] | ((uint)bytes[(bit >> 3) + 1] << 8);
+        pix[j] = convert_float((word >> (bit & 7)) & PACKED_MASK);
+    }
+}
+
+float convolvePacked(
+    __global const uchar *pIBuf,// Padded packed input
+    uint nPitch,             // Bytes per padded row
+    uint ix,                 // Output pixel column
+    uint iy,                 // Output pixel row
+    __constant float *pFilter// Filter coefficients of type float
+    )
+{
+    float pix[TAP_SIZE];
+    float nSum = 0.0f;
+
+    for (uint i = 0; i < TAP_SIZE; i++)
+    {
+        unpackRow(pIBuf + (iy + i) * nPitch, ix, pix);
+
+        #pragma unroll TAP_SIZE
+        for (uint j = 0; j < TAP_SIZE; j++)
+        {
+#if USE_INTRINSICS == 1
+            nSum = mad(pix[j], FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+            nSum = pix[j] * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+        }
+    }
+    return nSum;
+}
+
+// gaussianFilterPackedKernel is gaussianFilterKernel on packed input.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterPackedKernel(
+    __global uchar *pIBuf,   // 0: Padded packed input
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    float nSum = convolvePacked(pIBuf, PACKED_PITCH(nExWidth), ix, iy, pFilter);
+    pFilterOBuf[iy * nWidth + ix] = ROUND(nSum);
+}
+
+// enhanceFilterPackedKernel is enhanceFilterKernel on packed input.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void enhanceFilterPackedKernel(
+    __global uchar *pIBuf,   // 0: Padded packed input
+    __global T1 *pGaussianFilterBuf,// 1: Gaussian output of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth            // 5: Padded image width in pixels
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    int input_val = unpackPixel(pIBuf + (iy + TAP_SIZE/2) * PACKED_PITCH(nExWidth), ix + TAP_SIZE/2);
+    int filtered_val = pGaussianFilterBuf[iy * nWidth + ix];
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+    pEnhanceOBuf[iy * nWidth + ix] = clamp(enhanced_val, 0, (int)PACKED_MASK);
+}
+
+// combinedFilterPackedKernel is combinedFilterKernel on packed input.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterPackedKernel(
+    __global uchar *pIBuf,   // 0: Padded packed input
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    uint nPitch = PACKED_PITCH(nExWidth);
+    T1 filtered_val = ROUND(convolvePacked(pIBuf, nPitch, ix, iy, pFilter));
+    int input_val = unpackPixel(pIBuf + (iy + TAP_SIZE/2) * nPitch, ix + TAP_SIZE/2);
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - (int)filtered_val));
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = clamp(enhanced_val, 0, (int)PACKED_MASK));
+}
+#endif
+
+
+#ifndef VEC_WIDTH
+#define VEC_WIDTH 1
+#endif
+
+#if VEC_WIDTH > 1
+#define VTYPE_(t, n)            t##n
+#define VTYPE(t, n)             VTYPE_(t, n)
+#define T1V                     VTYPE(T1, VEC_WIDTH)
+#define FLOATV                  VTYPE(float, VEC_WIDTH)
+#define INTV                    VTYPE(int, VEC_WIDTH)
+#define VLOAD                   VTYPE(vload, VEC_WIDTH)
+#define VSTORE                  VTYPE(vstore, VEC_WIDTH)
+#define CONVERT_FLOATV          VTYPE(convert_float, VEC_WIDTH)
+#define CONVERT_INTV            VTYPE(convert_int, VEC_WIDTH)
+#define CONVERT_T1V_SAT         VTYPE(VTYPE(convert_, T1V), _sat)
+#define CONVERT_T1V_SAT_RTE     VTYPE(VTYPE(convert_, T1V), _sat_rte)
+#define CONVERT_T1_SAT          VTYPE(VTYPE(convert_, T1), _sat)
+
+// convolvePixel filters a single pixel; it handles the columns at the right edge
+// of the image which do not fill a whole vector.
+float convolvePixel(
+    __global T1 *pIBuf,      // Input buffer of type T1
+    uint nExWidth,           // Padded image width in pixels
+    __constant float *pFilter,// Filter coefficients of type float
+    uint ix,                 // Output column
+    uint iy                  // Output row
+    )
+{
+    uint Pos = iy * nExWidth + ix;
+    float nSum = 0.0f;
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++)
+            nSum = mad(convert_float(pIBuf[Pos + j]), FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+        Pos += nExWidth;
+    }
+    return nSum;
+}
+
+// convolveVec filters VEC_WIDTH horizontally adjacent pixels starting at (ix, iy).
+// Every tap is one unaligned vector load, the overlapping loads of a row hit the
+// same cache lines.
+FLOATV convolveVec(
+    __global T1 *pIBuf,      // Input buffer of type T1
+    uint nExWidth,           // Padded image width in pixels
+    __constant float *pFilter,// Filter coefficients of type float
+    uint ix,                 // First output column of the vector
+    uint iy                  // Output row
+    )
+{
+    uint Pos = iy * nExWidth + ix;
+    FLOATV nSum = (FLOATV)(0.0f);
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++)
+        {
+            FLOATV pix_val = CONVERT_FLOATV(VLOAD(0, pIBuf + Pos + j));
+#if USE_INTRINSICS == 1
+            nSum = mad(pix_val, (FLOATV)(FILTER_2D(pFilter, i * TAP_SIZE + j)), nSum);
+#else
+            nSum = pix_val * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+        }
+        Pos += nExWidth;
+    }
+    return nSum;
+}
+
+// gaussianFilterVecKernel is gaussianFilterKernel with VEC_WIDTH pixels per
+// work-item and one wide store, the NDRange is shrunk by VEC_WIDTH in x.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterVecKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,      // 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0) * VEC_WIDTH;
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    if (ix + VEC_WIDTH <= nWidth)
+    {
+        FLOATV nSum = convolveVec(pIBuf, nExWidth, pFilter, ix, iy);
+        VSTORE(CONVERT_T1V_SAT_RTE(nSum), 0, pFilterOBuf + iy * nWidth + ix);
+    }
+    else
+    {
+        for (uint x = ix; x < nWidth; x++)
+        {
+            float nSum = convolvePixel(pIBuf, nExWidth, pFilter, x, iy);
+            pFilterOBuf[iy * nWidth + x] = ROUND(nSum);
+        }
+    }
+}
+
+// enhanceFilterVecKernel is enhanceFilterKernel with VEC_WIDTH pixels per work-item.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void enhanceFilterVecKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pGaussianFilterBuf,      // 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,      // 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth            // 5: Padded image width in pixels   
+    )
+{
+    uint ix = get_global_id(0) * VEC_WIDTH;
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    uint InPos = (iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2));
+    uint OutPos = iy * nWidth + ix;
+
+    if (ix + VEC_WIDTH <= nWidth)
+    {
+        INTV input_val = CONVERT_INTV(VLOAD(0, pIBuf + InPos));
+        INTV filtered_val = CONVERT_INTV(VLOAD(0, pGaussianFilterBuf + OutPos));
+
+        //Enhance image, the saturating conversion clamps to the pixel range
+        VSTORE(CONVERT_T1V_SAT(input_val + (input_val - filtered_val)), 0, pEnhanceOBuf + OutPos);
+    }
+    else
+    {
+        for (uint x = 0; x < nWidth - ix; x++)
+        {
+            int input_val = pIBuf[InPos + x];
+            int filtered_val = pGaussianFilterBuf[OutPos + x];
+            pEnhanceOBuf[OutPos + x] = CONVERT_T1_SAT(input_val + (input_val - filtered_val));
+        }
+    }
+}
+
+// combinedFilterVecKernel is combinedFilterKernel with VEC_WIDTH pixels per
+// work-item and one wide store per output.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterVecKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,      // 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,      // 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0) * VEC_WIDTH;
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    uint InPos = (iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2));
+    uint OutPos = iy * nWidth + ix;
+
+    if (ix + VEC_WIDTH <= nWidth)
+    {
+        T1V filtered_val = CONVERT_T1V_SAT_RTE(convolveVec(pIBuf, nExWidth, pFilter, ix, iy));
+        INTV input_val = CONVERT_INTV(VLOAD(0, pIBuf + InPos));
+
+        //Enhance image, the saturating conversion clamps to the pixel range
+        INTV enhanced_val = input_val + (input_val - CONVERT_INTV(filtered_val));
+
+        STORE_FILTERED(VSTORE(filtered_val, 0, pFilterOBuf + OutPos));
+        STORE_ENHANCED(VSTORE(CONVERT_T1V_SAT(enhanced_val), 0, pEnhanceOBuf + OutPos));
+    }
+    else
+    {
+        for (uint x = 0; x < nWidth - ix; x++)
+        {
+            float nSum = convolvePixel(pIBuf, nExWidth, pFilter, ix + x, iy);
+            T1 filtered_val = ROUND(nSum);
+            int input_val = pIBuf[InPos + x];
+
+            STORE_FILTERED(pFilterOBuf[OutPos + x] = filtered_val);
+            STORE_ENHANCED(pEnhanceOBuf[OutPos + x] = CONVERT_T1_SAT(input_val + (input_val - filtered_val)));
+        }
+    }
+}
+#endif
+
+// The half kernels are the direct and vector kernels with half coefficients and
+// half accumulation, for 8-bit input on devices with cl_khr_fp16. Pixels up to
+// 255 are exact in half; the host bounds the error of the coefficient rounding
+// and of every product and partial sum (halfPrecisionError). The bound grows
+// with the tap count, 0.44 levels for the 3x3 and 1.07 for the 5x5 table before
+// the output rounding, so large filters are better served by the float path.
+#if HALF_PRECISION == 1
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+
+#if USE_INTRINSICS == 1
+#define HALF_MAD(a, b, c)   mad((a), (b), (c))
+#else
+#define HALF_MAD(a, b, c)   ((a) * (b) + (c))
+#endif
+
+// convolveHalfPixel filters a single pixel, also the right edge columns of the
+// vector kernels.
+half convolveHalfPixel(
+    __global T1 *pIBuf,      // Input buffer of type T1
+    uint nExWidth,           // Padded image width in pixels
+    __constant float *pFilter,// Filter coefficients of type float
+    uint ix,                 // Output column
+    uint iy                  // Output row
+    )
+{
+    uint Pos = iy * nExWidth + ix;
+    half nSum = 0;
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++)
+            nSum = HALF_MAD(convert_half(pIBuf[Pos + j]),
+                            convert_half(FILTER_2D(pFilter, i * TAP_SIZE + j)), nSum);
+        Pos += nExWidth;
+    }
+    return nSum;
+}
+
+#if VEC_WIDTH > 1
+#define HALFV                   VTYPE(half, VEC_WIDTH)
+#define CONVERT_HALFV           VTYPE(convert_half, VEC_WIDTH)
+
+// convolveHalfVec is convolveVec with half arithmetic.
+HALFV convolveHalfVec(
+    __global T1 *pIBuf,      // Input buffer of type T1
+    uint nExWidth,           // Padded image width in pixels
+    __constant float *pFilter,// Filter coefficients of type float
+    uint ix,                 // First output column of the vector
+    uint iy                  // Output row
+    )
+{
+    uint Pos = iy * nExWidth + ix;
+    HALFV nSum = 0;
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++)
+        {
+            HALFV pix_val = CONVERT_HALFV(VLOAD(0, pIBuf + Pos + j));
+            nSum = HALF_MAD(pix_val, (HALFV)(convert_half(FILTER_2D(pFilter, i * TAP_SIZE + j))), nSum);
+        }
+        Pos += nExWidth;
+    }
+    return nSum;
+}
+#endif
+
+// gaussianFilterHalfKernel is gaussianFilterKernel, or gaussianFilterVecKernel
+// for VEC_WIDTH > 1, with half accumulation.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterHalfKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0) * VEC_WIDTH;
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+#if VEC_WIDTH > 1
+    if (ix + VEC_WIDTH <= nWidth)
+    {
+        HALFV nSum = convolveHalfVec(pIBuf, nExWidth, pFilter, ix, iy);
+        VSTORE(CONVERT_T1V_SAT_RTE(nSum), 0, pFilterOBuf + iy * nWidth + ix);
+        return;
+    }
+#endif
+
+    for (uint x = ix; x < nWidth && x < ix + VEC_WIDTH; x++)
+    {
+        half nSum = convolveHalfPixel(pIBuf, nExWidth, pFilter, x, iy);
+        pFilterOBuf[iy * nWidth + x] = convert_uchar_sat_rte(nSum);
+    }
+}
+
+// combinedFilterHalfKernel is combinedFilterKernel, or combinedFilterVecKernel
+// for VEC_WIDTH > 1, with half accumulation.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterHalfKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0) * VEC_WIDTH;
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    uint InPos = (iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2));
+    uint OutPos = iy * nWidth + ix;
+
+#if VEC_WIDTH > 1
+    if (ix + VEC_WIDTH <= nWidth)
+    {
+        T1V filtered_val = CONVERT_T1V_SAT_RTE(convolveHalfVec(pIBuf, nExWidth, pFilter, ix, iy));
+        INTV input_val = CONVERT_INTV(VLOAD(0, pIBuf + InPos));
+
+        //Enhance image, the saturating conversion clamps to the pixel range
+        INTV enhanced_val = input_val + (input_val - CONVERT_INTV(filtered_val));
+
+        STORE_FILTERED(VSTORE(filtered_val, 0, pFilterOBuf + OutPos));
+        STORE_ENHANCED(VSTORE(CONVERT_T1V_SAT(enhanced_val), 0, pEnhanceOBuf + OutPos));
+        return;
+    }
+#endif
+
+    for (uint x = 0; x < nWidth - ix && x < VEC_WIDTH; x++)
+    {
+        half nSum = convolveHalfPixel(pIBuf, nExWidth, pFilter, ix + x, iy);
+        T1 filtered_val = convert_uchar_sat_rte(nSum);
+        int input_val = pIBuf[InPos + x];
+
+        STORE_FILTERED(pFilterOBuf[OutPos + x] = filtered_val);
+        STORE_ENHANCED(pEnhanceOBuf[OutPos + x] = convert_uchar_sat(POINT_OPS_INT(input_val + (input_val - filtered_val))));
+    }
+}
+#endif
+
+
+/***************************************************************************************
+* Recursive Gaussian (Young and van Vliet, 1995). coeff holds (B, b1/b0, b2/b0, b3/b0)
+* computed on the host from sigma, the cost per pixel does not depend on sigma. Each
+* line is filtered by a causal pass followed by an anti-causal pass; both start from the
+* steady state of a constant signal equal to the edge value.
+***************************************************************************************/
+
+// gaussianRecursiveRowKernel filters one image row per work-item into pRowOBuf.
+__kernel 
+void gaussianRecursiveRowKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global float *pRowOBuf,// 1: Row filtered output, nWidth x nHeight
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    float4 coeff             // 5: Recursive filter coefficients
+    )
+{
+    uint iy = get_global_id(0);
+
+    if (iy >= nHeight) return;
+
+    __global T1 *pIn = pIBuf + (iy + (TAP_SIZE/2)) * nExWidth + (TAP_SIZE/2);
+    __global float *pRow = pRowOBuf + iy * nWidth;
+
+    // Causal pass
+    float w1, w2, w3;
+    w1 = w2 = w3 = convert_float(pIn[0]);
+    for (uint x = 0; x < nWidth; x++)
+    {
+        float w0 = coeff.s0 * convert_float(pIn[x]) + coeff.s1 * w1 + coeff.s2 * w2 + coeff.s3 * w3;
+        pRow[x] = w0;
+        w3 = w2; w2 = w1; w1 = w0;
+    }
+
+    // Anti-causal pass, in place
+    float y1, y2, y3;
+    y1 = y2 = y3 = pRow[nWidth - 1];
+    for (int x = nWidth - 1; x >= 0; x--)
+    {
+        float y0 = coeff.s0 * pRow[x] + coeff.s1 * y1 + coeff.s2 * y2 + coeff.s3 * y3;
+        pRow[x] = y0;
+        y3 = y2; y2 = y1; y1 = y0;
+    }
+}
+
+// gaussianRecursiveColKernel filters one column of the row pass output per
+// work-item and writes the Gaussian output. Neighbouring work-items walk
+// neighbouring columns, so every step is a coalesced row access.
+__kernel 
+void gaussianRecursiveColKernel(
+    __global float *pRowIBuf,// 0: Row filtered output, nWidth x nHeight
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    float4 coeff             // 4: Recursive filter coefficients
+    )
+{
+    uint ix = get_global_id(0);
+
+    if (ix >= nWidth) return;
+
+    __global float *pCol = pRowIBuf + ix;
+
+    // Causal pass, in place
+    float w1, w2, w3;
+    w1 = w2 = w3 = pCol[0];
+    for (uint y = 0; y < nHeight; y++)
+    {
+        float w0 = coeff.s0 * pCol[y * nWidth] + coeff.s1 * w1 + coeff.s2 * w2 + coeff.s3 * w3;
+        pCol[y * nWidth] = w0;
+        w3 = w2; w2 = w1; w1 = w0;
+    }
+
+    // Anti-causal pass
+    float y1, y2, y3;
+    y1 = y2 = y3 = pCol[(nHeight - 1) * nWidth];
+    for (int y = nHeight - 1; y >= 0; y--)
+    {
+        float y0 = coeff.s0 * pCol[y * nWidth] + coeff.s1 * y1 + coeff.s2 * y2 + coeff.s3 * y3;
+        pFilterOBuf[y * nWidth + ix] = ROUND(y0);
+        y3 = y2; y2 = y1; y1 = y0;
+    }
+}
+
+
+/***************************************************************************************
+* Box approximation of the Gaussian: three successive box blurs whose radii the host
+* picks from sigma. Each box is a sliding sum, one add and one subtract per pixel for
+* any radius, and the radii are kernel arguments, so a new sigma needs no rebuild.
+* Lines are extended by replicating the edge pixel.
+***************************************************************************************/
+#define BOX_INDEX(x, n)     clamp((int)(x), 0, (int)(n) - 1)
+
+// boxSlideInput runs the first box over an input row. The sum of integer pixels
+// is exact, so it does not drift along the row.
+void boxSlideInput(__global T1 *pSrc, __global float *pDst, uint n, int r)
+{
+    float scale = 1.0f / (2 * r + 1);
+    int sum = 0;
+
+    for (int k = -r; k <= r; k++)
+        sum += pSrc[BOX_INDEX(k, n)];
+
+    for (int x = 0; x < (int)n; x++)
+    {
+        pDst[x] = sum * scale;
+        sum += (int)pSrc[BOX_INDEX(x + r + 1, n)] - (int)pSrc[BOX_INDEX(x - r, n)];
+    }
+}
+
+// boxSlide runs one box over n floats of pSrc, stride apart, into pDst.
+void boxSlide(__global float *pSrc, __global float *pDst, uint n, uint stride, int r)
+{
+    float scale = 1.0f / (2 * r + 1);
+    float sum = 0.0f;
+
+    for (int k = -r; k <= r; k++)
+        sum += pSrc[BOX_INDEX(k, n) * stride];
+
+    for (int x = 0; x < (int)n; x++)
+    {
+        pDst[x * stride] = sum * scale;
+        sum += pSrc[BOX_INDEX(x + r + 1, n) * stride] - pSrc[BOX_INDEX(x - r, n) * stride];
+    }
+}
+
+// boxSlideOutput is boxSlide storing rounded pixels of type T1.
+void boxSlideOutput(__global float *pSrc, __global T1 *pDst, uint n, uint stride, int r)
+{
+    float scale = 1.0f / (2 * r + 1);
+    float sum = 0.0f;
+
+    for (int k = -r; k <= r; k++)
+        sum += pSrc[BOX_INDEX(k, n) * stride];
+
+    for (int x = 0; x < (int)n; x++)
+    {
+        pDst[x * stride] = ROUND(sum * scale);
+        sum += pSrc[BOX_INDEX(x + r + 1, n) * stride] - pSrc[BOX_INDEX(x - r, n) * stride];
+    }
+}
+
+// gaussianBoxRowKernel runs the three boxes over one image row per work-item,
+// ping-ponging between pRowOBuf and pTmpBuf. The result is in pRowOBuf.
+__kernel 
+void gaussianBoxRowKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global float *pRowOBuf,// 1: Row filtered output, nWidth x nHeight
+    __global float *pTmpBuf, // 2: Intermediate box output, nWidth x nHeight
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    uint4 nRadius            // 6: Radii of the three boxes in s0 - s2
+    )
+{
+    uint iy = get_global_id(0);
+
+    if (iy >= nHeight) return;
+
+    __global T1 *pIn = pIBuf + (iy + (TAP_SIZE/2)) * nExWidth + (TAP_SIZE/2);
+    __global float *pRow = pRowOBuf + iy * nWidth;
+    __global float *pTmp = pTmpBuf + iy * nWidth;
+
+    boxSlideInput(pIn, pRow, nWidth, nRadius.s0);
+    boxSlide(pRow, pTmp, nWidth, 1, nRadius.s1);
+    boxSlide(pTmp, pRow, nWidth, 1, nRadius.s2);
+}
+
+// gaussianBoxColKernel runs the three boxes over one column of the row pass
+// output per work-item and writes the Gaussian output. Neighbouring work-items
+// walk neighbouring columns, so every step is a coalesced row access.
+__kernel 
+void gaussianBoxColKernel(
+    __global float *pRowIBuf,// 0: Row filtered output, nWidth x nHeight
+    __global float *pTmpBuf, // 1: Intermediate box output, nWidth x nHeight
+    __global T1 *pFilterOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint4 nRadius            // 5: Radii of the three boxes in s0 - s2
+    )
+{
+    uint ix = get_global_id(0);
+
+    if (ix >= nWidth) return;
+
+    boxSlide(pRowIBuf + ix, pTmpBuf + ix, nHeight, nWidth, nRadius.s0);
+    boxSlide(pTmpBuf + ix, pRowIBuf + ix, nHeight, nWidth, nRadius.s1);
+    boxSlideOutput(pRowIBuf + ix, pFilterOBuf + ix, nHeight, nWidth, nRadius.s2);
+}
+
+
+// The fixed-point kernels convolve 8-bit input with integer coefficients that
+// sum to 1 << FIXED_SHIFT. Every partial sum is at most 255 << FIXED_SHIFT,
+// which stays below 2^24 for FIXED_SHIFT 16, so mad24 is exact.
+#if FIXED_POINT == 1
+
+#if USE_INTRINSICS == 1
+#define FIXED_MAD(a, b, c)  mad24((uint)(a), (b), (c))
+#else
+#define FIXED_MAD(a, b, c)  ((uint)(a) * (b) + (c))
+#endif
+
+#define FIXED_ROUND(x)  convert_uchar_sat(((x) + (1u << (FIXED_SHIFT - 1))) >> FIXED_SHIFT)
+
+// gaussianFilterFixedKernel is gaussianFilterKernel with uint accumulation.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterFixedKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant uint *pFilter // 5: Filter coefficients scaled by 1 << FIXED_SHIFT
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+#if USE_LDS == 1
+    // Every work-item takes part in the tile load, none may return before it
+    __local T1 local_input[TILE_STRIDE * TILE_YRES];
+    loadTile(pIBuf, local_input, nExWidth, nHeight + TAP_SIZE - 1);
+#endif
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    uint Pos = iy * nExWidth + ix;
+    uint nSum = 0;
+
+#if USE_LDS == 1
+    Pos = get_local_id(1) * TILE_STRIDE + get_local_id(0);
+#endif
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++,Pos++)
+        {
+#if USE_LDS == 1 
+            nSum = FIXED_MAD(local_input[Pos], FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+            nSum = FIXED_MAD(pIBuf[Pos], FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#endif
+        }
+#if USE_LDS == 1
+        Pos += TILE_STRIDE - TAP_SIZE;
+#else
+        Pos += nExWidth - TAP_SIZE;
+#endif
+    }
+
+    //Save output
+    pFilterOBuf[iy * nWidth + ix] = FIXED_ROUND(nSum);
+}
+
+// combinedFilterFixedKernel is combinedFilterKernel with uint accumulation.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterFixedKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant uint *pFilter // 6: Filter coefficients scaled by 1 << FIXED_SHIFT
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+#if USE_LDS == 1
+    // Every work-item takes part in the tile load, none may return before it
+    __local T1 local_input[TILE_STRIDE * TILE_YRES];
+    loadTile(pIBuf, local_input, nExWidth, nHeight + TAP_SIZE - 1);
+#endif
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    uint Pos = iy * nExWidth + ix;
+    uint nSum = 0;
+
+    T1 input_val = pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+
+#if USE_LDS == 1
+    Pos = get_local_id(1) * TILE_STRIDE + get_local_id(0);
+#endif
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++,Pos++)
+        {
+#if USE_LDS == 1 
+            nSum = FIXED_MAD(local_input[Pos], FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+            nSum = FIXED_MAD(pIBuf[Pos], FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#endif
+        }
+#if USE_LDS == 1
+        Pos += TILE_STRIDE - TAP_SIZE;
+#else
+        Pos += nExWidth - TAP_SIZE;
+#endif
+    }
+
+    T1 filtered_val = FIXED_ROUND(nSum);
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = enhanced_val);
+}
+
+#endif
+
+
+// The image kernels read the unpadded input through a sampler instead of the
+// padded buffer, and the reads go through the texture cache. The sampler
+// addressing mode implements BORDER_MODE. CLK_ADDRESS_CLAMP returns 0 outside
+// the image, the zero border of the padded copy. Mirrored and wrapped addressing
+// is only defined for normalized coordinates, so those modes address pixel
+// centers as (x + 0.5) / nWidth.
+#if USE_IMAGE == 1
+
+#if BORDER_MODE == 1
+__constant sampler_t imageSampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+#elif BORDER_MODE == 2
+__constant sampler_t imageSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_MIRRORED_REPEAT | CLK_FILTER_NEAREST;
+#elif BORDER_MODE == 3
+__constant sampler_t imageSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_REPEAT | CLK_FILTER_NEAREST;
+#else
+__constant sampler_t imageSampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP | CLK_FILTER_NEAREST;
+#endif
+
+#if BORDER_MODE == 2 || BORDER_MODE == 3
+#define IMAGE_COORD(x, y)   (float2)(((x) + 0.5f) / nWidth, ((y) + 0.5f) / nHeight)
+#else
+#define IMAGE_COORD(x, y)   (int2)((x), (y))
+#endif
+
+// gaussianFilterImageKernel is gaussianFilterKernel reading from an image.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterImageKernel(
+    __read_only image2d_t pIImg,// 0: Unpadded input image, one unsigned channel
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    __constant float *pFilter// 4: Filter coefficients of type float
+    )
+{
+    int ix = get_global_id(0);
+    int iy = get_global_id(1);
+
+    // Process only if pIImg[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    float nSum = 0.0f;
+
+    for (int i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (int j=0; j<TAP_SIZE; j++)
+        {
+            uint pix_val = read_imageui(pIImg, imageSampler,
+                            IMAGE_COORD(ix + j - TAP_SIZE/2, iy + i - TAP_SIZE/2)).x;
+#if USE_INTRINSICS == 1
+            nSum = mad(convert_float(pix_val), FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+            nSum = pix_val * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+        }
+    }
+
+    //Save output
+    pFilterOBuf[iy * nWidth + ix] = ROUND(nSum);
+}
+
+// enhanceFilterImageKernel is enhanceFilterKernel reading from an image.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void enhanceFilterImageKernel(
+    __read_only image2d_t pIImg,// 0: Unpadded input image, one unsigned channel
+    __global T1 *pGaussianFilterBuf,// 1: Gaussian output of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight             // 4: Image height in pixels
+    )
+{
+    int ix = get_global_id(0);
+    int iy = get_global_id(1);
+
+    // Process only if pIImg[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    int input_val = read_imageui(pIImg, imageSampler, IMAGE_COORD(ix, iy)).x;
+    T1 filtered_val = pGaussianFilterBuf[iy * nWidth + ix];
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+    enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+    enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+    pEnhanceOBuf[iy * nWidth + ix] = enhanced_val;
+}
+
+// combinedFilterImageKernel is combinedFilterKernel reading from an image.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterImageKernel(
+    __read_only image2d_t pIImg,// 0: Unpadded input image, one unsigned channel
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    int ix = get_global_id(0);
+    int iy = get_global_id(1);
+
+    // Process only if pIImg[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    float nSum = 0.0f;
+
+    for (int i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (int j=0; j<TAP_SIZE; j++)
+        {
+            uint pix_val = read_imageui(pIImg, imageSampler,
+                            IMAGE_COORD(ix + j - TAP_SIZE/2, iy + i - TAP_SIZE/2)).x;
+#if USE_INTRINSICS == 1
+            nSum = mad(convert_float(pix_val), FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+            nSum = pix_val * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+        }
+    }
+
+    int input_val = read_imageui(pIImg, imageSampler, IMAGE_COORD(ix, iy)).x;
+    T1 filtered_val = ROUND(nSum);
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+    enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+    enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = enhanced_val);
+}
+
+#endif
+
+
+// The border kernels read the unpadded input and resolve out of range taps
+// themselves. BORDER_INDEX maps a coordinate that is at most TAP_SIZE/2 outside
+// [0, n) back into the image. Reflect repeats the edge pixel (dcba|abcd).
+#if BORDER_MODE >= 0
+
+#if BORDER_MODE == 1
+#define BORDER_INDEX(x, n)  clamp((x), 0, (n) - 1)
+#elif BORDER_MODE == 2
+#define BORDER_INDEX(x, n)  ((x) < 0 ? -(x) - 1 : ((x) >= (n) ? 2 * (n) - (x) - 1 : (x)))
+#elif BORDER_MODE == 3
+#define BORDER_INDEX(x, n)  ((x) < 0 ? (x) + (n) : ((x) >= (n) ? (x) - (n) : (x)))
+#else
+#define BORDER_INDEX(x, n)  (x)
+#endif
+
+// convolveBorder returns the filtered value of pixel (ix, iy). Work-groups whose
+// tile and halo lie inside the image take the unchecked interior path; the test
+// only depends on the group id, so work-items of a group never diverge on it.
+float convolveBorder(
+    __global T1 *pIBuf,      // Unpadded input buffer of type T1
+    int ix,                  // Output pixel column
+    int iy,                  // Output pixel row
+    int nWidth,              // Image width in pixels
+    int nHeight,             // Image height in pixels
+    __constant float *pFilter// Filter coefficients of type float
+    )
+{
+    float nSum = 0.0f;
+
+    int tile_x = (int)(get_global_id(0) - get_local_id(0)) - TAP_SIZE/2;
+    int tile_y = (int)(get_global_id(1) - get_local_id(1)) - TAP_SIZE/2;
+
+    if (tile_x >= 0 && tile_y >= 0 &&
+        tile_x + LOCAL_XRES + TAP_SIZE - 1 <= nWidth &&
+        tile_y + LOCAL_YRES + TAP_SIZE - 1 <= nHeight)
+    {
+        uint Pos = (iy - TAP_SIZE/2) * nWidth + (ix - TAP_SIZE/2);
+
+        for (uint i=0; i<TAP_SIZE; i++)
+        {
+            #pragma unroll TAP_SIZE
+            for (uint j=0; j<TAP_SIZE; j++)
+            {
+#if USE_INTRINSICS == 1
+                nSum = mad(convert_float(pIBuf[Pos + j]), FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+                nSum = pIBuf[Pos + j] * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+            }
+            Pos += nWidth;
+        }
+        return nSum;
+    }
+
+    for (int i=0; i<TAP_SIZE; i++)
+    {
+        int y = iy + i - TAP_SIZE/2;
+#if BORDER_MODE == 0
+        if (y < 0 || y >= nHeight) continue;
+#else
+        y = BORDER_INDEX(y, nHeight);
+#endif
+        #pragma unroll TAP_SIZE
+        for (int j=0; j<TAP_SIZE; j++)
+        {
+            int x = ix + j - TAP_SIZE/2;
+#if BORDER_MODE == 0
+            if (x < 0 || x >= nWidth) continue;
+#else
+            x = BORDER_INDEX(x, nWidth);
+#endif
+#if USE_INTRINSICS == 1
+            nSum = mad(convert_float(pIBuf[y * nWidth + x]), FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+            nSum = pIBuf[y * nWidth + x] * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+        }
+    }
+    return nSum;
+}
+
+// gaussianFilterBorderKernel is gaussianFilterKernel on an unpadded input.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterBorderKernel(
+    __global T1 *pIBuf,      // 0: Unpadded input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Input row pitch in pixels, equals nWidth
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    int ix = get_global_id(0);
+    int iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    float nSum = convolveBorder(pIBuf, ix, iy, nWidth, nHeight, pFilter);
+
+    //Save output
+    pFilterOBuf[iy * nWidth + ix] = ROUND(nSum);
+}
+
+// combinedFilterBorderKernel is combinedFilterKernel on an unpadded input.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterBorderKernel(
+    __global T1 *pIBuf,      // 0: Unpadded input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Input row pitch in pixels, equals nWidth
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    int ix = get_global_id(0);
+    int iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    float nSum = convolveBorder(pIBuf, ix, iy, nWidth, nHeight, pFilter);
+
+    int input_val = pIBuf[iy * nWidth + ix];
+    T1 filtered_val = ROUND(nSum);
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+    enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+    enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = enhanced_val);
+}
+
+#endif
+
+
+// The folded kernels are gaussianFilterKernel and combinedFilterKernel for
+// coefficient tables with FOLD_COEFF symmetry. Each unique coefficient of the
+// top-left quadrant multiplies the integer sum of its up to four mirrored pixels.
+// With the loops unrolled the centre row and column tests are resolved at compile
+// time.
+#if FOLD_COEFF == 1
+
+#if USE_LDS == 1
+#define FOLD_SRC    local_input
+#else
+#define FOLD_SRC    pIBuf
+#endif
+
+// gaussianFilterFoldedKernel is gaussianFilterKernel with folded taps.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterFoldedKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+#if USE_LDS == 1
+    // Every work-item takes part in the tile load, none may return before it
+    __local T1 local_input[TILE_STRIDE * TILE_YRES];
+    loadTile(pIBuf, local_input, nExWidth, nHeight + TAP_SIZE - 1);
+
+    uint Pos = get_local_id(1) * TILE_STRIDE + get_local_id(0);
+    uint stride = TILE_STRIDE;
+#else
+    uint Pos = iy * nExWidth + ix;
+    uint stride = nExWidth;
+#endif
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    float nSum = 0.0f;
+
+    #pragma unroll
+    for (uint i=0; i<=TAP_SIZE/2; i++)
+    {
+        uint top = Pos + i * stride;
+        uint bottom = Pos + (TAP_SIZE - 1 - i) * stride;
+
+        #pragma unroll
+        for (uint j=0; j<=TAP_SIZE/2; j++)
+        {
+            int pix_sum = FOLD_SRC[top + j];
+            if (j < TAP_SIZE/2)
+                pix_sum += FOLD_SRC[top + TAP_SIZE - 1 - j];
+            if (i < TAP_SIZE/2)
+            {
+                pix_sum += FOLD_SRC[bottom + j];
+                if (j < TAP_SIZE/2)
+                    pix_sum += FOLD_SRC[bottom + TAP_SIZE - 1 - j];
+            }
+            nSum = FOLD_MAD(pix_sum, FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+        }
+    }
+
+    //Save output
+    pFilterOBuf[iy * nWidth + ix] = ROUND(nSum);
+}
+
+// combinedFilterFoldedKernel is combinedFilterKernel with folded taps.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterFoldedKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+#if USE_LDS == 1
+    // Every work-item takes part in the tile load, none may return before it
+    __local T1 local_input[TILE_STRIDE * TILE_YRES];
+    loadTile(pIBuf, local_input, nExWidth, nHeight + TAP_SIZE - 1);
+
+    uint Pos = get_local_id(1) * TILE_STRIDE + get_local_id(0);
+    uint stride = TILE_STRIDE;
+#else
+    uint Pos = iy * nExWidth + ix;
+    uint stride = nExWidth;
+#endif
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    float nSum = 0.0f;
+
+    #pragma unroll
+    for (uint i=0; i<=TAP_SIZE/2; i++)
+    {
+        uint top = Pos + i * stride;
+        uint bottom = Pos + (TAP_SIZE - 1 - i) * stride;
+
+        #pragma unroll
+        for (uint j=0; j<=TAP_SIZE/2; j++)
+        {
+            int pix_sum = FOLD_SRC[top + j];
+            if (j < TAP_SIZE/2)
+                pix_sum += FOLD_SRC[top + TAP_SIZE - 1 - j];
+            if (i < TAP_SIZE/2)
+            {
+                pix_sum += FOLD_SRC[bottom + j];
+                if (j < TAP_SIZE/2)
+                    pix_sum += FOLD_SRC[bottom + TAP_SIZE - 1 - j];
+            }
+            nSum = FOLD_MAD(pix_sum, FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+        }
+    }
+
+    T1 input_val = pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+    T1 filtered_val = ROUND(nSum);
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+    enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+    enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = enhanced_val);
+}
+
+#endif
+
+// With USE_LDS 2 work-items share the taps of a filter row through sub-group
+// shuffles instead of a local memory tile. Each work-item loads the pixel in its
+// own column and reads the TAP_SIZE - 1 pixels to its right from the lanes that
+// loaded them. Lanes near the right end of a sub-group or work-group row have no
+// such partner for some taps and load those pixels from global memory. The host
+// only builds this mode when the device has a shuffle extension.
+#if USE_LDS == 2
+#if SUBGROUP_EXT == 2
+#pragma OPENCL EXTENSION cl_intel_subgroups : enable
+#define SUB_GROUP_SHUFFLE(x, lane)  intel_sub_group_shuffle(x, lane)
+#else
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle : enable
+#define SUB_GROUP_SHUFFLE(x, lane)  sub_group_shuffle(x, lane)
+#endif
+
+// convolveShuffle returns the filtered value of pixel (ix, iy). Work-items outside
+// the image clamp their loads instead of returning, as every lane of the
+// sub-group has to take part in each shuffle.
+float convolveShuffle(
+    __global T1 *pIBuf,
+    uint ix,
+    uint iy,
+    uint nWidth,
+    uint nHeight,
+    uint nExWidth,
+    __constant float *pFilter)
+{
+    uint lane = get_sub_group_local_id();
+    uint lastLane = get_sub_group_size() - 1;
+    // Clamped to the last output column, whose taps end at the last padded column
+    uint Pos = min(iy, nHeight - 1) * nExWidth + min(ix, nWidth - 1);
+
+    // Bit j is set when lane + j loaded the pixel j columns to the right. The
+    // lane to sub-group mapping is not assumed, the partner's position is checked.
+    uint shared = 1;
+    #pragma unroll TAP_SIZE
+    for (uint j=1; j<TAP_SIZE; j++)
+    {
+        uint partnerPos = SUB_GROUP_SHUFFLE(Pos, min(lane + j, lastLane));
+        shared |= (uint)(partnerPos == Pos + j) << j;
+    }
+
+    uint filter_offset = 0;
+    float nSum = 0.0f;
+    float tVal = 0.0f;
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        uint own_val = pIBuf[Pos];
+
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++)
+        {
+            uint pix_val = own_val;
+            if (j > 0)
+            {
+                pix_val = SUB_GROUP_SHUFFLE(own_val, min(lane + j, lastLane));
+                if (!(shared & (1u << j)))
+                    pix_val = pIBuf[Pos + j];
+            }
+#if USE_INTRINSICS == 1
+            nSum = mad(convert_float(pix_val), FILTER_2D(pFilter, filter_offset++), nSum);
+#else
+            tVal = pix_val * FILTER_2D(pFilter, filter_offset++);
+            nSum = tVal + nSum;
+#endif
+        }
+        Pos += nExWidth;
+    }
+
+    return nSum;
+}
+
+// gaussianFilterShuffleKernel is gaussianFilterKernel sharing taps by shuffles.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterShuffleKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    float nSum = convolveShuffle(pIBuf, ix, iy, nWidth, nHeight, nExWidth, pFilter);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    //Save output
+    pFilterOBuf[iy * nWidth + ix] = ROUND(nSum);
+}
+
+// combinedFilterShuffleKernel is combinedFilterKernel sharing taps by shuffles.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterShuffleKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global T1 *pFilterOBuf,// 1: Output buffer of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output buffer of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    float nSum = convolveShuffle(pIBuf, ix, iy, nWidth, nHeight, nExWidth, pFilter);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight || OUT_OF_ROI(ix, iy)) return;
+
+    int input_val = pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+    T1 filtered_val = ROUND(nSum);
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+    enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+    enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = enhanced_val);
+}
+
+#endif
+
+// The multi-channel kernels filter colour images. Interleaved input stores every
+// pixel as one T1 x 4 vector (RGB carries an unused fourth channel) and filters
+// all channels with float4 math in one pass. Planar input stores CHANNELS padded
+// planes one after another; the host stacks the planes along dimension 1 of the
+// NDRange, so one launch filters every channel.
+#ifndef CHANNELS
+#define CHANNELS 1
+#endif
+
+#if CHANNELS > 1
+#if PLANAR == 0
+
+#if PIX_WIDTH == 8
+#define T4                      uchar4
+#define CONVERT_T4_SAT(x)       convert_uchar4_sat(x)
+#define CONVERT_T4_SAT_RTE(x)   convert_uchar4_sat_rte(x)
+#else
+#define T4                      ushort4
+#define CONVERT_T4_SAT(x)       convert_ushort4_sat(x)
+#define CONVERT_T4_SAT_RTE(x)   convert_ushort4_sat_rte(x)
+#endif
+
+// convolveRgba filters the four channels of pixel (ix, iy).
+float4 convolveRgba(
+    __global T4 *pIBuf,      // Input buffer of type T4
+    uint nExWidth,           // Padded image width in pixels
+    __constant float *pFilter,// Filter coefficients of type float
+    uint ix,                 // Output column
+    uint iy                  // Output row
+    )
+{
+    uint Pos = iy * nExWidth + ix;
+    float4 nSum = (float4)(0.0f);
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++)
+        {
+            float4 pix_val = convert_float4(pIBuf[Pos + j]);
+#if USE_INTRINSICS == 1
+            nSum = mad(pix_val, (float4)(FILTER_2D(pFilter, i * TAP_SIZE + j)), nSum);
+#else
+            nSum = pix_val * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+        }
+        Pos += nExWidth;
+    }
+    return nSum;
+}
+
+// gaussianFilterRgbaKernel is gaussianFilterKernel on interleaved 4-channel pixels.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterRgbaKernel(
+    __global T4 *pIBuf,      // 0: Input buffer of type T4
+    __global T4 *pFilterOBuf,// 1: Output buffer of type T4
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    //Save output
+    pFilterOBuf[iy * nWidth + ix] = CONVERT_T4_SAT_RTE(convolveRgba(pIBuf, nExWidth, pFilter, ix, iy));
+}
+
+// enhanceFilterRgbaKernel is enhanceFilterKernel on interleaved 4-channel pixels.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void enhanceFilterRgbaKernel(
+    __global T4 *pIBuf,      // 0: Input buffer of type T4
+    __global T4 *pGaussianFilterBuf,// 1: Gaussian output of type T4
+    __global T4 *pEnhanceOBuf,// 2: Output buffer of type T4
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth            // 5: Padded image width in pixels
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    int4 input_val = convert_int4(pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))]);
+    int4 filtered_val = convert_int4(pGaussianFilterBuf[iy * nWidth + ix]);
+
+    //Enhance image, the saturating conversion clamps to the pixel range
+    pEnhanceOBuf[iy * nWidth + ix] = CONVERT_T4_SAT(input_val + (input_val - filtered_val));
+}
+
+// combinedFilterRgbaKernel is combinedFilterKernel on interleaved 4-channel pixels.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterRgbaKernel(
+    __global T4 *pIBuf,      // 0: Input buffer of type T4
+    __global T4 *pFilterOBuf,// 1: Output buffer of type T4
+    __global T4 *pEnhanceOBuf,// 2: Output buffer of type T4
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    // Process only if pIBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    T4 filtered_val = CONVERT_T4_SAT_RTE(convolveRgba(pIBuf, nExWidth, pFilter, ix, iy));
+    int4 input_val = convert_int4(pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))]);
+
+    //Enhance image, the saturating conversion clamps to the pixel range
+    int4 enhanced_val = input_val + (input_val - convert_int4(filtered_val));
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = CONVERT_T4_SAT(enhanced_val));
+}
+
+#else
+
+// PLANE_ROW splits the stacked row index of dimension 1 into the plane and the
+// row within it and moves the buffers to that plane. Rows past the last plane
+// return.
+#define PLANE_ROW(iy, plane)                                                   \
+    uint plane = iy / nHeight;                                                 \
+    iy -= plane * nHeight;                                                     \
+    if (ix >= nWidth || plane >= CHANNELS) return;
+
+// convolvePlane filters pixel (ix, iy) of one padded plane.
+float convolvePlane(
+    __global T1 *pIBuf,      // Plane of the input buffer
+    uint nExWidth,           // Padded image width in pixels
+    __constant float *pFilter,// Filter coefficients of type float
+    uint ix,                 // Output column
+    uint iy                  // Output row
+    )
+{
+    uint Pos = iy * nExWidth + ix;
+    float nSum = 0.0f;
+
+    for (uint i=0; i<TAP_SIZE; i++)
+    {
+        #pragma unroll TAP_SIZE
+        for (uint j=0; j<TAP_SIZE; j++)
+        {
+#if USE_INTRINSICS == 1
+            nSum = mad(convert_float(pIBuf[Pos + j]), FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+            nSum = pIBuf[Pos + j] * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+        }
+        Pos += nExWidth;
+    }
+    return nSum;
+}
+
+// gaussianFilterPlanarKernel is gaussianFilterKernel over CHANNELS stacked planes.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianFilterPlanarKernel(
+    __global T1 *pIBuf,      // 0: Input planes of type T1
+    __global T1 *pFilterOBuf,// 1: Output planes of type T1
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nExWidth,           // 4: Padded image width in pixels
+    __constant float *pFilter// 5: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    PLANE_ROW(iy, plane)
+    pIBuf += plane * nExWidth * (nHeight + TAP_SIZE - 1);
+    pFilterOBuf += plane * nWidth * nHeight;
+
+    //Save output
+    pFilterOBuf[iy * nWidth + ix] = ROUND(convolvePlane(pIBuf, nExWidth, pFilter, ix, iy));
+}
+
+// enhanceFilterPlanarKernel is enhanceFilterKernel over CHANNELS stacked planes.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void enhanceFilterPlanarKernel(
+    __global T1 *pIBuf,      // 0: Input planes of type T1
+    __global T1 *pGaussianFilterBuf,// 1: Gaussian output planes of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output planes of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth            // 5: Padded image width in pixels
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    PLANE_ROW(iy, plane)
+    pIBuf += plane * nExWidth * (nHeight + TAP_SIZE - 1);
+    pGaussianFilterBuf += plane * nWidth * nHeight;
+    pEnhanceOBuf += plane * nWidth * nHeight;
+
+    int input_val = pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+    int filtered_val = pGaussianFilterBuf[iy * nWidth + ix];
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+    enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+    enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+    pEnhanceOBuf[iy * nWidth + ix] = enhanced_val;
+}
+
+// combinedFilterPlanarKernel is combinedFilterKernel over CHANNELS stacked planes.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterPlanarKernel(
+    __global T1 *pIBuf,      // 0: Input planes of type T1
+    __global T1 *pFilterOBuf,// 1: Output planes of type T1
+    __global T1 *pEnhanceOBuf,// 2: Output planes of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter// 6: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    PLANE_ROW(iy, plane)
+    pIBuf += plane * nExWidth * (nHeight + TAP_SIZE - 1);
+    pFilterOBuf += plane * nWidth * nHeight;
+    pEnhanceOBuf += plane * nWidth * nHeight;
+
+    T1 filtered_val = ROUND(convolvePlane(pIBuf, nExWidth, pFilter, ix, iy));
+    int input_val = pIBuf[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+
+    //Enhance image
+    int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+    enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+    enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+    enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+    enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+    STORE_FILTERED(pFilterOBuf[iy * nWidth + ix] = filtered_val);
+    STORE_ENHANCED(pEnhanceOBuf[iy * nWidth + ix] = enhanced_val);
+}
+
+#endif
+#endif
+
+// The pyramid kernels build level n + 1 from level n in one pass: the filter is
+// only evaluated at the even rows and columns that the 2x decimation keeps.
+// Levels are read with a replicated border. Level 0 is the input buffer, read
+// inside its padding (nSrcPad) when the host padded it; the other levels lie
+// unpadded one after another in the pyramid buffer, at nSrcBase / nDstBase.
+#ifndef PYRAMID_LEVELS
+#define PYRAMID_LEVELS 0
+#endif
+
+#if PYRAMID_LEVELS > 0
+#define PYRAMID_INDEX(x, n)     clamp((int)(x), 0, (int)(n) - 1)
+
+// gaussianPyramidKernel computes one pixel of the next pyramid level.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianPyramidKernel(
+    __global T1 *pSrc,       // 0: Input buffer or pyramid buffer of type T1
+    uint nSrcBase,           // 1: First pixel of the source level
+    uint nSrcWidth,          // 2: Source level width in pixels
+    uint nSrcHeight,         // 3: Source level height in pixels
+    uint nSrcPitch,          // 4: Source row pitch in pixels
+    uint nSrcPad,            // 5: Padding around the source level in pixels
+    __global T1 *pDst,       // 6: Pyramid buffer of type T1
+    uint nDstBase,           // 7: First pixel of the output level
+    __constant float *pFilter// 8: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+    uint nDstWidth = (nSrcWidth + 1) / 2;
+    uint nDstHeight = (nSrcHeight + 1) / 2;
+
+    // Process only if pDst[ix,iy] is within valid bounds.
+    if (ix >= nDstWidth || iy >= nDstHeight) return;
+
+    pSrc += nSrcBase + nSrcPad * nSrcPitch + nSrcPad;
+    int sx = 2 * (int)ix - TAP_SIZE/2;
+    int sy = 2 * (int)iy - TAP_SIZE/2;
+    float nSum = 0.0f;
+
+    for (int i=0; i<TAP_SIZE; i++)
+    {
+        __global T1 *pRow = pSrc + PYRAMID_INDEX(sy + i, nSrcHeight) * nSrcPitch;
+
+        #pragma unroll TAP_SIZE
+        for (int j=0; j<TAP_SIZE; j++)
+        {
+#if USE_INTRINSICS == 1
+            nSum = mad(convert_float(pRow[PYRAMID_INDEX(sx + j, nSrcWidth)]),
+                            FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+            nSum = pRow[PYRAMID_INDEX(sx + j, nSrcWidth)] * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+        }
+    }
+
+    pDst[nDstBase + iy * nDstWidth + ix] = ROUND(nSum);
+}
+
+// gaussianPyramidLdsKernel runs as a single work-group once the source level fits
+// in PYRAMID_LDS_DIM x PYRAMID_LDS_DIM. The source is loaded into local memory
+// once; every further level is computed from the previous one in local memory,
+// ping-ponging between two arrays, and only written to global memory as output.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void gaussianPyramidLdsKernel(
+    __global T1 *pSrc,       // 0: Input buffer or pyramid buffer of type T1
+    uint nSrcBase,           // 1: First pixel of the source level
+    uint nSrcWidth,          // 2: Source level width in pixels
+    uint nSrcHeight,         // 3: Source level height in pixels
+    uint nSrcPitch,          // 4: Source row pitch in pixels
+    uint nSrcPad,            // 5: Padding around the source level in pixels
+    __global T1 *pDst,       // 6: Pyramid buffer of type T1
+    uint nDstBase,           // 7: First pixel of the first output level
+    uint nLevels,            // 8: Levels to build
+    __constant float *pFilter// 9: Filter coefficients of type float
+    )
+{
+    __local T1 levelA[PYRAMID_LDS_DIM * PYRAMID_LDS_DIM];
+    __local T1 levelB[(PYRAMID_LDS_DIM / 2) * (PYRAMID_LDS_DIM / 2)];
+    __local T1 *pCur = levelA;
+    __local T1 *pNext = levelB;
+
+    uint lid = get_local_id(1) * LOCAL_XRES + get_local_id(0);
+    uint groupSize = LOCAL_XRES * LOCAL_YRES;
+
+    pSrc += nSrcBase + nSrcPad * nSrcPitch + nSrcPad;
+    for (uint p = lid; p < nSrcWidth * nSrcHeight; p += groupSize)
+        levelA[p] = pSrc[(p / nSrcWidth) * nSrcPitch + p % nSrcWidth];
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (uint level = 0; level < nLevels; level++)
+    {
+        uint nDstWidth = (nSrcWidth + 1) / 2;
+        uint nDstHeight = (nSrcHeight + 1) / 2;
+
+        for (uint p = lid; p < nDstWidth * nDstHeight; p += groupSize)
+        {
+            int sx = 2 * (int)(p % nDstWidth) - TAP_SIZE/2;
+            int sy = 2 * (int)(p / nDstWidth) - TAP_SIZE/2;
+            float nSum = 0.0f;
+
+            for (int i=0; i<TAP_SIZE; i++)
+            {
+                __local T1 *pRow = pCur + PYRAMID_INDEX(sy + i, nSrcHeight) * nSrcWidth;
+
+                #pragma unroll TAP_SIZE
+                for (int j=0; j<TAP_SIZE; j++)
+                {
+#if USE_INTRINSICS == 1
+                    nSum = mad(convert_float(pRow[PYRAMID_INDEX(sx + j, nSrcWidth)]),
+                                    FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+#else
+                    nSum = pRow[PYRAMID_INDEX(sx + j, nSrcWidth)] * FILTER_2D(pFilter, i * TAP_SIZE + j) + nSum;
+#endif
+                }
+            }
+
+            T1 out = ROUND(nSum);
+            pNext[p] = out;
+            pDst[nDstBase + p] = out;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        // The next level is at most a quarter of this one, both arrays hold it
+        __local T1 *pTmp = pCur;
+        pCur = pNext;
+        pNext = pTmp;
+        nDstBase += nDstWidth * nDstHeight;
+        nSrcWidth = nDstWidth;
+        nSrcHeight = nDstHeight;
+    }
+}
+
+// laplacianCollapseKernel computes level k of the collapsed Laplacian pyramid,
+// R_k = expand(R_k+1) + gain_k * (G_k - expand(G_k+1)), where G are the Gaussian
+// levels and R_N = G_N at the coarsest level. expand() interpolates the half
+// resolution level with the same filter, using the taps that land on its pixels
+// and normalized by their weight. Expanding, subtracting and applying the gain
+// happen in one pass; level 0 is clamped and written as the enhanced output,
+// the other levels stay in float in the collapse buffer.
+#if PIX_WIDTH == 8
+#define PIX_MAX 255.0f
+#else
+#define PIX_MAX 65535.0f
+#endif
+
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void laplacianCollapseKernel(
+    __global T1 *pSrc,       // 0: Input buffer or pyramid buffer holding G_k
+    uint nSrcBase,           // 1: First pixel of G_k
+    uint nWidth,             // 2: Level k width in pixels
+    uint nHeight,            // 3: Level k height in pixels
+    uint nSrcPitch,          // 4: G_k row pitch in pixels
+    uint nSrcPad,            // 5: Padding around G_k in pixels
+    __global T1 *pPyramid,   // 6: Pyramid buffer of type T1
+    __global float *pCollapse,// 7: Collapsed levels of type float, pyramid layout
+    uint nCoarseBase,        // 8: First pixel of level k + 1
+    uint nOutBase,           // 9: First pixel of level k
+    uint nCoarsest,          // 10: Level k + 1 is the coarsest, R_k+1 = G_k+1
+    uint nFinest,            // 11: Level k is 0, write pEnhanceOBuf
+    float fGain,             // 12: Gain of the Laplacian level k
+    __global T1 *pEnhanceOBuf,// 13: Enhanced output of type T1
+    __constant float *pFilter// 14: Filter coefficients of type float
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    // Process only if pSrc[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    uint nCoarseWidth = (nWidth + 1) / 2;
+    uint nCoarseHeight = (nHeight + 1) / 2;
+    float upG = 0.0f;
+    float upR = 0.0f;
+    float weight = 0.0f;
+
+    for (int i=0; i<TAP_SIZE; i++)
+    {
+        int sy = (int)iy + i - TAP_SIZE/2;
+        if (sy & 1)
+            continue;
+        uint Pos = nCoarseBase + PYRAMID_INDEX(sy >> 1, nCoarseHeight) * nCoarseWidth;
+
+        #pragma unroll TAP_SIZE
+        for (int j=0; j<TAP_SIZE; j++)
+        {
+            int sx = (int)ix + j - TAP_SIZE/2;
+            if (sx & 1)
+                continue;
+            uint coarsePos = Pos + PYRAMID_INDEX(sx >> 1, nCoarseWidth);
+            float w = FILTER_2D(pFilter, i * TAP_SIZE + j);
+
+            upG = mad(convert_float(pPyramid[coarsePos]), w, upG);
+            if (!nCoarsest)
+                upR = mad(pCollapse[coarsePos], w, upR);
+            weight += w;
+        }
+    }
+
+    upG /= weight;
+    upR = nCoarsest ? upG : upR / weight;
+
+    float center = pSrc[nSrcBase + (iy + nSrcPad) * nSrcPitch + ix + nSrcPad];
+    float nSum = mad(fGain, center - upG, upR);
+
+    // The coarser levels feed the next finer one, the chain runs once on the result
+    if (nFinest)
+    {
+#if POINT_OPS == 1
+        nSum = pointOps(nSum);
+#endif
+        pEnhanceOBuf[iy * nWidth + ix] = ROUND(clamp(nSum, 0.0f, PIX_MAX));
+    }
+    else
+        pCollapse[nOutBase + iy * nWidth + ix] = nSum;
+}
+#endif
+
+#if PERSISTENT == 1
+// combinedFilterPersistentKernel is launched with one work-group per compute unit
+// instead of one per tile. Each group takes LOCAL_XRES x LOCAL_YRES output tiles
+// from pTileCounter[0] until the tiles of all nFrames frames are taken, so the
+// number of launches and groups stays the same for any image size or frame count.
+// Every group passes the end exactly once before it leaves; the last one to leave
+// (counted in pTileCounter[1]) resets both counters for the next launch.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void combinedFilterPersistentKernel(
+    __global T1 *pIBuf,      // 0: Input frames of type T1, padded, one after another
+    __global T1 *pFilterOBuf,// 1: Output frames of type T1
+    __global T1 *pEnhanceOBuf,// 2: Enhanced output frames of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nExWidth,           // 5: Padded image width in pixels
+    __constant float *pFilter,// 6: Filter coefficients of type float
+    volatile __global uint *pTileCounter,// 7: Next tile and finished groups, zero between launches
+    uint nFrames             // 8: Frames in the buffers
+    )
+{
+    __local uint tile;
+    uint tilesX = (nWidth + LOCAL_XRES - 1) / LOCAL_XRES;
+    uint tilesPerFrame = tilesX * ((nHeight + LOCAL_YRES - 1) / LOCAL_YRES);
+    uint nTiles = tilesPerFrame * nFrames;
+    uint inFrameSize = nExWidth * (nHeight + TAP_SIZE - 1);
+    uint outFrameSize = nWidth * nHeight;
+    bool leader = (get_local_id(0) == 0 && get_local_id(1) == 0);
+
+    for (;;)
+    {
+        if (leader)
+            tile = atomic_inc(&pTileCounter[0]);
+        barrier(CLK_LOCAL_MEM_FENCE);
+        uint t = tile;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (t >= nTiles)
+            break;
+
+        uint frame = t / tilesPerFrame;
+        t -= frame * tilesPerFrame;
+        uint ix = (t % tilesX) * LOCAL_XRES + get_local_id(0);
+        uint iy = (t / tilesX) * LOCAL_YRES + get_local_id(1);
+
+        // Process only if pIBuf[ix,iy] is within valid bounds.
+        if (ix >= nWidth || iy >= nHeight)
+            continue;
+
+        __global T1 *pFrame = pIBuf + frame * inFrameSize;
+        uint Pos = iy * nExWidth + ix;
+        float nSum = 0.0f;
+
+        for (uint i=0; i<TAP_SIZE; i++)
+        {
+            #pragma unroll TAP_SIZE
+            for (uint j=0; j<TAP_SIZE; j++)
+            {
+                nSum = mad(convert_float(pFrame[Pos + j]), FILTER_2D(pFilter, i * TAP_SIZE + j), nSum);
+            }
+            Pos += nExWidth;
+        }
+
+        T1 input_val = pFrame[(iy + (TAP_SIZE/2)) * nExWidth + (ix + (TAP_SIZE/2))];
+        T1 filtered_val = ROUND(nSum);
+
+        //Enhance image
+        int enhanced_val = POINT_OPS_INT(input_val + (input_val - filtered_val));
+
+#if PIX_WIDTH == 8
+        enhanced_val = enhanced_val > 255 ? 255 : enhanced_val;
+        enhanced_val = enhanced_val < 0   ?   0 : enhanced_val;
+#else    
+        enhanced_val = enhanced_val > 65535 ? 65535 : enhanced_val;
+        enhanced_val = enhanced_val <     0 ?     0 : enhanced_val;
+#endif
+
+        uint OutPos = frame * outFrameSize + iy * nWidth + ix;
+        STORE_FILTERED(pFilterOBuf[OutPos] = filtered_val);
+        STORE_ENHANCED(pEnhanceOBuf[OutPos] = enhanced_val);
+    }
+
+    if (leader && atomic_inc(&pTileCounter[1]) == get_num_groups(0) - 1)
+    {
+        pTileCounter[0] = 0;
+        pTileCounter[1] = 0;
+    }
+}
+#endif
+
+#if SUMMED_AREA == 1
+// Summed-area table (integral image) of the input and box means of any radius
+// from it in O(1) per pixel. Window sums are differences of table entries, which
+// unsigned arithmetic gets right modulo 2^n even where the table itself wraps; the
+// host picks ulong only when a window sum can exceed 32 bits.
+#if SAT_WIDE == 1
+#define SAT_T ulong
+#else
+#define SAT_T uint
+#endif
+
+// satRowScanKernel computes the inclusive prefix sums of one row per work-group.
+// The row is scanned in chunks of SAT_SCAN_SIZE pixels, each by a Hillis-Steele
+// scan in local memory; the chunk total is carried into the next chunk.
+__kernel 
+__attribute__((reqd_work_group_size(SAT_SCAN_SIZE, 1, 1)))
+void satRowScanKernel(
+    __global T1 *pIBuf,      // 0: Input buffer of type T1
+    __global SAT_T *pSat,    // 1: Row prefix sums, nWidth x nHeight
+    uint nWidth,             // 2: Image width in pixels
+    uint nHeight,            // 3: Image height in pixels
+    uint nSrcPitch,          // 4: Input row pitch in pixels
+    uint nSrcPad             // 5: Padding around the input in pixels
+    )
+{
+    __local SAT_T scan[SAT_SCAN_SIZE];
+    uint lid = get_local_id(0);
+    uint iy = get_group_id(0);
+
+    // The whole work-group shares the row
+    if (iy >= nHeight) return;
+
+    __global T1 *pRow = pIBuf + (iy + nSrcPad) * nSrcPitch + nSrcPad;
+    __global SAT_T *pOut = pSat + iy * nWidth;
+    SAT_T carry = 0;
+
+    for (uint x0 = 0; x0 < nWidth; x0 += SAT_SCAN_SIZE)
+    {
+        uint x = x0 + lid;
+        scan[lid] = (x < nWidth) ? pRow[x] : 0;
+
+        for (uint offset = 1; offset < SAT_SCAN_SIZE; offset <<= 1)
+        {
+            barrier(CLK_LOCAL_MEM_FENCE);
+            SAT_T v = (lid >= offset) ? scan[lid - offset] : 0;
+            barrier(CLK_LOCAL_MEM_FENCE);
+            scan[lid] += v;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        if (x < nWidth)
+            pOut[x] = carry + scan[lid];
+        carry += scan[SAT_SCAN_SIZE - 1];
+
+        // The next chunk overwrites scan
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
+// satColScanKernel adds the row prefix sums down one column per work-item, in
+// place. Neighbouring work-items walk neighbouring columns, so every step is a
+// coalesced row access.
+__kernel 
+void satColScanKernel(
+    __global SAT_T *pSat,    // 0: Row prefix sums in, summed-area table out
+    uint nWidth,             // 1: Image width in pixels
+    uint nHeight             // 2: Image height in pixels
+    )
+{
+    uint ix = get_global_id(0);
+
+    if (ix >= nWidth) return;
+
+    SAT_T sum = 0;
+    for (uint y = 0; y < nHeight; y++)
+    {
+        sum += pSat[y * nWidth + ix];
+        pSat[y * nWidth + ix] = sum;
+    }
+}
+
+#define SAT_AT(x, y)    (((x) < 0 || (y) < 0) ? (SAT_T)0 : pSat[(y) * nWidth + (x)])
+
+// boxMeanKernel computes the mean of the (2r + 1)^2 window around each pixel,
+// clipped to the image, from four table reads. r is nRadius, or with nUseMap
+// the radius map value scaled so that 255 is nRadius.
+__kernel 
+__attribute__((reqd_work_group_size(LOCAL_XRES, LOCAL_YRES, 1)))
+void boxMeanKernel(
+    __global SAT_T *pSat,    // 0: Summed-area table, nWidth x nHeight
+    __global uchar *pRadiusMap,// 1: Per-pixel radius, 255 maps to nRadius, 0 to radius 0, used with nUseMap
+    __global T1 *pOBuf,      // 2: Box mean output of type T1
+    uint nWidth,             // 3: Image width in pixels
+    uint nHeight,            // 4: Image height in pixels
+    uint nRadius,            // 5: Box radius, or the radius of map value 255
+    uint nUseMap             // 6: Read the radius from pRadiusMap
+    )
+{
+    uint ix = get_global_id(0);
+    uint iy = get_global_id(1);
+
+    // Process only if pOBuf[ix,iy] is within valid bounds.
+    if (ix >= nWidth || iy >= nHeight) return;
+
+    int r = nRadius;
+    if (nUseMap)
+        r = (pRadiusMap[iy * nWidth + ix] * nRadius + 127) / 255;
+
+    int x0 = max((int)ix - r, 0) - 1;
+    int y0 = max((int)iy - r, 0) - 1;
+    int x1 = min((int)ix + r, (int)nWidth - 1);
+    int y1 = min((int)iy + r, (int)nHeight - 1);
+
+    SAT_T nSum = SAT_AT(x1, y1) - SAT_AT(x0, y1) - SAT_AT(x1, y0) + SAT_AT(x0, y0);
+    float area = (float)((x1 - x0) * (y1 - y0));
+
+    pOBuf[iy * nWidth + ix] = ROUND(convert_float(nSum) / area);
+}
+#endif
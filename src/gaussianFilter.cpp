@@ -30,6 +30,8 @@
  *
  ********************************************************************************
  */
+#include <string.h>
+#include <math.h>
 #include "gaussianFilter.h"
 
 /**
@@ -39,20 +41,19 @@
  *
  *  @param[in] oclContext       : pointer to the OCL context
  *  @param[in] oclDevice        : pointer to the OCL device
- *  @param[out] gaussianFilterKernel : pointer to the kernel
- *  @param[in] filtSize         : Filter size if set to = 3 - 3x3 gaussianarable filter
- *                                                      = 5 - 5x5 gaussianarable filter
- *                                                      
- *  @param[in] bitWidth         : Bits per pixel
- *  @param[in] useLds           : Should Lds memory be used by the OpenCL kernel for input
+ *  @param[in] config           : filter size, bits per pixel, filter mode, rows
+ *                                per work-item, vector width, the
+ *                                LDS/intrinsics/folding switches, the point
+ *                                operation chain and, when baking, the
+ *                                coefficients to build with. useLds 2 needs
+ *                                a sub-group shuffle extension
+ *  @param[out] kernels         : kernels created from the program
  *
  *  @return bool : true if successful; otherwise false.
  *******************************************************************************
  */
 bool buildKernels(cl_context oclContext, cl_device_id oclDevice,
-                cl_kernel *gaussianFilterKernel, cl_kernel *enhancedKernel, cl_kernel *cominedKernel, 
-                cl_uint filtSize, cl_uint bitWidth,
-                cl_int useLds, cl_int useIntrinsics)
+                filterConfig *config, filterKernels *kernels)
 {
     cl_int err = CL_SUCCESS;
 
@@ -65,26 +66,79 @@ bool buildKernels(cl_context oclContext, cl_device_id oclDevice,
     err = convertToString(filename, &source, &sourceSize);
     CHECK_RESULT(err != CL_SUCCESS, "Error reading file %s ", filename);
 
+    /**************************************************************************
+     * The generated point operation chain is compiled ahead of the kernel     *
+     * file so the enhance step can inline it                                  *
+     **************************************************************************/
+    char *pointSource = generatePointOps(config);
+    CHECK_RESULT(config->numPointOps && pointSource == NULL,
+                    "Memory allocation failed: pointSource");
+    const char *sources[2] = { pointSource ? pointSource : "", source };
+    size_t sourceSizes[2] = { strlen(sources[0]), sourceSize };
+
     /**************************************************************************
      * Create kernel program.                                                  *
      **************************************************************************/
     cl_program programNonSeparableFilter =
-                    clCreateProgramWithSource(oclContext, 1,
-                                    (const char **) &source,
-                                    (const size_t *) &sourceSize, &err);
+                    clCreateProgramWithSource(oclContext, 2, sources,
+                                    sourceSizes, &err);
+    free(pointSource);
     CHECK_RESULT(err != CL_SUCCESS,
                     "clCreateProgramWithSource failed with Error code = %d",
                     err);
 
+    /**************************************************************************
+     * The shuffle mode picks its sub-group extension. The caller has already  *
+     * replaced it by the LDS tile on devices without one                      *
+     **************************************************************************/
+    cl_int subgroupExt = SUBGROUP_EXT_NONE;
+    if (config->useLds == LDS_MODE_SHUFFLE)
+        subgroupExt = subgroupShuffleExt(oclDevice);
+
     /**************************************************************************
      * Build the kernel and check for errors. If errors are found, it will be  *
      * printed to console                                                      *
      **************************************************************************/
-    char option[256];
-    sprintf(option, "-DTAP_SIZE=%d -DPIX_WIDTH=%d -DUSE_LDS=%d -DLOCAL_XRES=%d -DLOCAL_YRES=%d -DUSE_INTRINSICS=%d",
-                    filtSize, bitWidth, useLds, LOCAL_XRES, LOCAL_YRES, useIntrinsics);
+    cl_uint numCoeff = config->filtSize * config->filtSize + config->filtSize;
+    size_t optionSize = 1024 + (config->bakeCoeff ? numCoeff * 20 : 0);
+    char *option = (char *) malloc(optionSize);
+    CHECK_RESULT(option == NULL, "Memory allocation failed: option");
+
+    int len = sprintf(option, "-DTAP_SIZE=%d -DPIX_WIDTH=%d -DUSE_LDS=%d -DLOCAL_XRES=%d -DLOCAL_YRES=%d -DUSE_INTRINSICS=%d -DROWS_PER_ITEM=%d -DVEC_WIDTH=%d -DBAKED_COEFF=%d -DFIXED_POINT=%d -DFIXED_SHIFT=%d -DUSE_IMAGE=%d -DBORDER_MODE=%d -DFOLD_COEFF=%d",
+                    config->filtSize, config->bitWidth, config->useLds, config->localXRes, config->localYRes, config->useIntrinsics,
+                    config->rowsPerItem, config->vecWidth, config->bakeCoeff, config->fixedPoint, FIXED_POINT_SHIFT,
+                    config->useImage, config->borderMode, config->foldCoeff);
+    len += sprintf(option + len, " -DSUBGROUP_EXT=%d -DHALF_PRECISION=%d -DCHANNELS=%d -DPLANAR=%d -DPYRAMID_LEVELS=%d -DPYRAMID_LDS_DIM=%d -DPERSISTENT=%d",
+                    subgroupExt, config->halfPrecision, config->channels, config->planar,
+                    config->pyramidLevels, PYRAMID_LDS_DIM, config->persistent);
+    len += sprintf(option + len, " -DSUMMED_AREA=%d -DSAT_WIDE=%d -DSAT_SCAN_SIZE=%d -DOUTPUT_SELECT=%d",
+                    config->satRadius > 0, satIsWide(config), SAT_SCAN_SIZE, config->outputSelect);
+    len += sprintf(option + len, " -DSTRIP=%d -DSTRIP_WIDTH=%d -DSTRIP_ROWS=%d -DBATCH=%d -DPACKED_BITS=%d",
+                    config->strip, STRIP_WIDTH, STRIP_ROWS, config->batched, packedBits(config->bitWidth));
+    if (config->roi.width)
+        len += sprintf(option + len, " -DROI_END_X=%d -DROI_END_Y=%d",
+                        config->roi.x + config->roi.width, config->roi.y + config->roi.height);
+
+    /* Baked coefficients are passed as initializer lists, printed with enough
+       digits to round-trip the float values exactly */
+    if (config->bakeCoeff)
+    {
+        len += sprintf(option + len, " -DFILTER_COEFF_2D={");
+        for (cl_uint i = 0; i < config->filtSize * config->filtSize; i++)
+        {
+            if (config->fixedPoint)
+                len += sprintf(option + len, "%s%uu", i ? "," : "", config->filterCoeffFixed[i]);
+            else
+                len += sprintf(option + len, "%s%.9gf", i ? "," : "", config->filterCoeff[i]);
+        }
+        len += sprintf(option + len, "} -DFILTER_COEFF_1D={");
+        for (cl_uint i = 0; i < config->filtSize; i++)
+            len += sprintf(option + len, "%s%.9gf", i ? "," : "", config->filterCoeff1D[i]);
+        len += sprintf(option + len, "}");
+    }
 
     err = clBuildProgram(programNonSeparableFilter, 1, &(oclDevice), option, NULL, NULL);
+    free(option);
     free(source);
     if (err != CL_SUCCESS)
     {
@@ -105,21 +159,183 @@ bool buildKernels(cl_context oclContext, cl_device_id oclDevice,
     /**************************************************************************
      * Create kernel                                                           *
      **************************************************************************/
-    *gaussianFilterKernel = clCreateKernel(programNonSeparableFilter, GAUSSIANFILTER_KERNEL,
-                    &err);
-    CHECK_RESULT(err != CL_SUCCESS, 
-                    "clCreateKernel failed with Error code = %d", err);
+    memset(kernels, 0, sizeof(filterKernels));
+
+    const char *gaussianKernelName = GAUSSIANFILTER_KERNEL;
+    const char *enhancedKernelName = ENHANCED_KERNEL;
+    const char *combinedKernelName = COMBINED_KERNEL;
+    if (config->persistent)
+    {
+        combinedKernelName = COMBINED_PERSISTENT_KERNEL;
+    }
+    else if (packedBits(config->bitWidth))
+    {
+        gaussianKernelName = GAUSSIANFILTER_PACKED_KERNEL;
+        enhancedKernelName = ENHANCED_PACKED_KERNEL;
+        combinedKernelName = COMBINED_PACKED_KERNEL;
+    }
+    else if (config->strip)
+    {
+        gaussianKernelName = GAUSSIANFILTER_STRIP_KERNEL;
+        combinedKernelName = COMBINED_STRIP_KERNEL;
+    }
+    else if (config->channels > 1 && config->planar)
+    {
+        gaussianKernelName = GAUSSIANFILTER_PLANAR_KERNEL;
+        enhancedKernelName = ENHANCED_PLANAR_KERNEL;
+        combinedKernelName = COMBINED_PLANAR_KERNEL;
+    }
+    else if (config->channels > 1)
+    {
+        gaussianKernelName = GAUSSIANFILTER_RGBA_KERNEL;
+        enhancedKernelName = ENHANCED_RGBA_KERNEL;
+        combinedKernelName = COMBINED_RGBA_KERNEL;
+    }
+    else if (config->rowsPerItem > 1)
+    {
+        gaussianKernelName = GAUSSIANFILTER_BLOCKED_KERNEL;
+        combinedKernelName = COMBINED_BLOCKED_KERNEL;
+    }
+    else if (config->halfPrecision)
+    {
+        gaussianKernelName = GAUSSIANFILTER_HALF_KERNEL;
+        if (config->vecWidth > 1)
+            enhancedKernelName = ENHANCED_VEC_KERNEL;
+        combinedKernelName = COMBINED_HALF_KERNEL;
+    }
+    else if (config->vecWidth > 1)
+    {
+        gaussianKernelName = GAUSSIANFILTER_VEC_KERNEL;
+        enhancedKernelName = ENHANCED_VEC_KERNEL;
+        combinedKernelName = COMBINED_VEC_KERNEL;
+    }
+    else if (config->useImage)
+    {
+        gaussianKernelName = GAUSSIANFILTER_IMAGE_KERNEL;
+        enhancedKernelName = ENHANCED_IMAGE_KERNEL;
+        combinedKernelName = COMBINED_IMAGE_KERNEL;
+    }
+    else if (config->borderMode != BORDER_MODE_HOST_PAD)
+    {
+        gaussianKernelName = GAUSSIANFILTER_BORDER_KERNEL;
+        combinedKernelName = COMBINED_BORDER_KERNEL;
+    }
+    else if (config->useLds == LDS_MODE_SHUFFLE)
+    {
+        gaussianKernelName = GAUSSIANFILTER_SHUFFLE_KERNEL;
+        combinedKernelName = COMBINED_SHUFFLE_KERNEL;
+    }
+    else if (config->fixedPoint)
+    {
+        gaussianKernelName = GAUSSIANFILTER_FIXED_KERNEL;
+        combinedKernelName = COMBINED_FIXED_KERNEL;
+    }
+    else if (config->foldCoeff)
+    {
+        gaussianKernelName = GAUSSIANFILTER_FOLDED_KERNEL;
+        combinedKernelName = COMBINED_FOLDED_KERNEL;
+    }
 
-    *enhancedKernel = clCreateKernel(programNonSeparableFilter, ENHANCED_KERNEL,
+    kernels->gaussianKernel = clCreateKernel(programNonSeparableFilter, gaussianKernelName,
                     &err);
     CHECK_RESULT(err != CL_SUCCESS, 
                     "clCreateKernel failed with Error code = %d", err);
 
-    *cominedKernel = clCreateKernel(programNonSeparableFilter, COMBINED_KERNEL,
+    kernels->enhancedKernel = clCreateKernel(programNonSeparableFilter, enhancedKernelName,
                     &err);
     CHECK_RESULT(err != CL_SUCCESS, 
                     "clCreateKernel failed with Error code = %d", err);
 
+    if (config->filterMode == FILTER_MODE_RECURSIVE)
+    {
+        kernels->rowKernel = clCreateKernel(programNonSeparableFilter, GAUSSIAN_RECURSIVE_ROW_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+
+        kernels->colKernel = clCreateKernel(programNonSeparableFilter, GAUSSIAN_RECURSIVE_COL_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+    }
+
+    if (config->filterMode == FILTER_MODE_BOX)
+    {
+        kernels->rowKernel = clCreateKernel(programNonSeparableFilter, GAUSSIAN_BOX_ROW_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+
+        kernels->colKernel = clCreateKernel(programNonSeparableFilter, GAUSSIAN_BOX_COL_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+    }
+
+    if (config->filterMode == FILTER_MODE_SEPARABLE)
+    {
+        kernels->rowKernel = clCreateKernel(programNonSeparableFilter, GAUSSIAN_ROW_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+
+        kernels->colKernel = clCreateKernel(programNonSeparableFilter, GAUSSIAN_COL_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+
+        kernels->combinedKernel = clCreateKernel(programNonSeparableFilter, COMBINED_SEPARABLE_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+    }
+    else
+    {
+        kernels->combinedKernel = clCreateKernel(programNonSeparableFilter, combinedKernelName,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+    }
+
+    if (config->pyramidLevels)
+    {
+        kernels->pyramidKernel = clCreateKernel(programNonSeparableFilter, GAUSSIAN_PYRAMID_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+
+        kernels->pyramidLdsKernel = clCreateKernel(programNonSeparableFilter, GAUSSIAN_PYRAMID_LDS_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+    }
+
+    if (config->multiScale)
+    {
+        kernels->collapseKernel = clCreateKernel(programNonSeparableFilter, LAPLACIAN_COLLAPSE_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+    }
+
+    if (config->satRadius)
+    {
+        kernels->satRowKernel = clCreateKernel(programNonSeparableFilter, SAT_ROW_SCAN_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+
+        kernels->satColKernel = clCreateKernel(programNonSeparableFilter, SAT_COL_SCAN_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+
+        kernels->boxMeanKernel = clCreateKernel(programNonSeparableFilter, BOX_MEAN_KERNEL,
+                        &err);
+        CHECK_RESULT(err != CL_SUCCESS, 
+                        "clCreateKernel failed with Error code = %d", err);
+    }
+
     clReleaseProgram(programNonSeparableFilter);
     return true;
 }
@@ -129,106 +345,489 @@ bool buildKernels(cl_context oclContext, cl_device_id oclDevice,
  *  @fn     setGaussianFilterKernelArgs
  *  @brief  This function sets the arguments for the filter kernel
  *
- *  @param[in] gaussianFilterKernel : pointer to Gaussian filter kernel
- *  @param[in] input           : OCL memory containing input
- *  @param[out] output         : OCL memory to hold output
- *  @param[in] filterCoeff     : OCL memory containing filter coefficients
+ *  @param[in] kernels         : kernels created by buildKernels
+ *  @param[in] buffers         : OCL memory holding the input, outputs, filter
+ *                               coefficients and intermediate results
+ *  @param[in] config          : filter size, filter mode, input type, border
+ *                               mode and the frame count of the persistent kernel
  *  @param[in] width           : Image width
  *  @param[in] height          : Image height
- *  @param[in] filtSize        : Filter size
  *
  *  @return bool : true if successful; otherwise false.
  *******************************************************************************
  */
-bool setKernelArgs(cl_kernel gaussianFilterKernel, cl_kernel enhancedKernel, cl_kernel combinedKernel, 
-                   cl_mem input, cl_mem output1, cl_mem output2, cl_mem filterCoeff, cl_uint width,
-                cl_uint height, cl_uint filtSize)
+bool setKernelArgs(filterKernels *kernels, filterBuffers *buffers,
+                filterConfig *config, cl_uint width, cl_uint height)
 {
     int cnt = 0;
-    cl_uint extWidth = width + filtSize - 1;
+    cl_uint extWidth = width + config->filtSize - 1;
     cl_int err = CL_SUCCESS;
 
-    err  = clSetKernelArg(gaussianFilterKernel, cnt++, sizeof(cl_mem), &(input));
-    err |= clSetKernelArg(gaussianFilterKernel, cnt++, sizeof(cl_mem), &(output1));
-    err |= clSetKernelArg(gaussianFilterKernel, cnt++, sizeof(cl_uint), &(width));
-    err |= clSetKernelArg(gaussianFilterKernel, cnt++, sizeof(cl_uint), &(height));
-    err |= clSetKernelArg(gaussianFilterKernel, cnt++, sizeof(cl_uint), &(extWidth));
-    err |= clSetKernelArg(gaussianFilterKernel, cnt++, sizeof(cl_mem),
-                    &(filterCoeff));
+    /* Device-side borders read the input unpadded */
+    if (config->borderMode != BORDER_MODE_HOST_PAD)
+        extWidth = width;
+
+    err  = clSetKernelArg(kernels->gaussianKernel, cnt++, sizeof(cl_mem), &(buffers->input));
+    err |= clSetKernelArg(kernels->gaussianKernel, cnt++, sizeof(cl_mem), &(buffers->gaussianOutput));
+    err |= clSetKernelArg(kernels->gaussianKernel, cnt++, sizeof(cl_uint), &(width));
+    err |= clSetKernelArg(kernels->gaussianKernel, cnt++, sizeof(cl_uint), &(height));
+    if (!config->useImage)
+        err |= clSetKernelArg(kernels->gaussianKernel, cnt++, sizeof(cl_uint), &(extWidth));
+    err |= clSetKernelArg(kernels->gaussianKernel, cnt++, sizeof(cl_mem),
+                    &(buffers->filterCoeff));
 
     CHECK_RESULT(err != CL_SUCCESS,
                     "clSetKernelArg failed with Error code = %d", err);
 
     cnt = 0;
-    err  = clSetKernelArg(enhancedKernel, cnt++, sizeof(cl_mem), &(input));
-    err |= clSetKernelArg(enhancedKernel, cnt++, sizeof(cl_mem), &(output1));
-    err |= clSetKernelArg(enhancedKernel, cnt++, sizeof(cl_mem), &(output2));
-    err |= clSetKernelArg(enhancedKernel, cnt++, sizeof(cl_uint), &(width));
-    err |= clSetKernelArg(enhancedKernel, cnt++, sizeof(cl_uint), &(height));
-    err |= clSetKernelArg(enhancedKernel, cnt++, sizeof(cl_uint), &(extWidth));
+    err  = clSetKernelArg(kernels->enhancedKernel, cnt++, sizeof(cl_mem), &(buffers->input));
+    err |= clSetKernelArg(kernels->enhancedKernel, cnt++, sizeof(cl_mem), &(buffers->gaussianOutput));
+    err |= clSetKernelArg(kernels->enhancedKernel, cnt++, sizeof(cl_mem), &(buffers->enhancedOutput));
+    err |= clSetKernelArg(kernels->enhancedKernel, cnt++, sizeof(cl_uint), &(width));
+    err |= clSetKernelArg(kernels->enhancedKernel, cnt++, sizeof(cl_uint), &(height));
+    if (!config->useImage)
+        err |= clSetKernelArg(kernels->enhancedKernel, cnt++, sizeof(cl_uint), &(extWidth));
     
     CHECK_RESULT(err != CL_SUCCESS,
                     "clSetKernelArg failed with Error code = %d", err);
 
+    /* The fused separable kernel takes the 1D coefficients instead of the 2D table */
+    cl_mem combinedCoeff = (config->filterMode == FILTER_MODE_SEPARABLE) ?
+                    buffers->filterCoeff1D : buffers->filterCoeff;
+
     cnt = 0;
-    err  = clSetKernelArg(combinedKernel, cnt++, sizeof(cl_mem), &(input));
-    err |= clSetKernelArg(combinedKernel, cnt++, sizeof(cl_mem), &(output1));
-    err |= clSetKernelArg(combinedKernel, cnt++, sizeof(cl_mem), &(output2));
-    err |= clSetKernelArg(combinedKernel, cnt++, sizeof(cl_uint), &(width));
-    err |= clSetKernelArg(combinedKernel, cnt++, sizeof(cl_uint), &(height));
-    err |= clSetKernelArg(combinedKernel, cnt++, sizeof(cl_uint), &(extWidth));
-    err |= clSetKernelArg(combinedKernel, cnt++, sizeof(cl_mem),
-                    &(filterCoeff));
+    err  = clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_mem), &(buffers->input));
+    err |= clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_mem), &(buffers->gaussianOutput));
+    err |= clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_mem), &(buffers->enhancedOutput));
+    err |= clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_uint), &(width));
+    err |= clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_uint), &(height));
+    if (!config->useImage)
+        err |= clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_uint), &(extWidth));
+    err |= clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_mem),
+                    &(combinedCoeff));
+    if (config->persistent)
+    {
+        err |= clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_mem), &(buffers->tileCounter));
+        err |= clSetKernelArg(kernels->combinedKernel, cnt++, sizeof(cl_uint), &(config->frames));
+    }
 
     CHECK_RESULT(err != CL_SUCCESS,
                     "clSetKernelArg failed with Error code = %d", err);
 
+    if (config->filterMode == FILTER_MODE_SEPARABLE)
+    {
+        cnt = 0;
+        err  = clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_mem), &(buffers->input));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_mem), &(buffers->rowOutput));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(width));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(height));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(extWidth));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_mem),
+                        &(buffers->filterCoeff1D));
+
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clSetKernelArg failed with Error code = %d", err);
+
+        cnt = 0;
+        err  = clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_mem), &(buffers->rowOutput));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_mem), &(buffers->gaussianOutput));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_uint), &(width));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_uint), &(height));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_mem),
+                        &(buffers->filterCoeff1D));
+
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clSetKernelArg failed with Error code = %d", err);
+    }
+    else if (config->filterMode == FILTER_MODE_RECURSIVE)
+    {
+        cl_float4 coeff;
+        computeRecursiveCoeff(config->sigma, &coeff);
+
+        cnt = 0;
+        err  = clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_mem), &(buffers->input));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_mem), &(buffers->rowOutput));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(width));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(height));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(extWidth));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_float4), &(coeff));
+
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clSetKernelArg failed with Error code = %d", err);
+
+        cnt = 0;
+        err  = clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_mem), &(buffers->rowOutput));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_mem), &(buffers->gaussianOutput));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_uint), &(width));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_uint), &(height));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_float4), &(coeff));
+
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clSetKernelArg failed with Error code = %d", err);
+    }
+    else if (config->filterMode == FILTER_MODE_BOX)
+    {
+        /* A new sigma only needs new radii here, not a rebuild */
+        cl_uint4 radius = {{ 0, 0, 0, 0 }};
+        for (cl_uint i = 0; i < BOX_PASSES; i++)
+            radius.s[i] = config->boxRadius[i];
+
+        cnt = 0;
+        err  = clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_mem), &(buffers->input));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_mem), &(buffers->rowOutput));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_mem), &(buffers->boxTemp));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(width));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(height));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint), &(extWidth));
+        err |= clSetKernelArg(kernels->rowKernel, cnt++, sizeof(cl_uint4), &(radius));
+
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clSetKernelArg failed with Error code = %d", err);
+
+        cnt = 0;
+        err  = clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_mem), &(buffers->rowOutput));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_mem), &(buffers->boxTemp));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_mem), &(buffers->gaussianOutput));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_uint), &(width));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_uint), &(height));
+        err |= clSetKernelArg(kernels->colKernel, cnt++, sizeof(cl_uint4), &(radius));
+
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clSetKernelArg failed with Error code = %d", err);
+    }
+
     return true;
 }
 
+/* Slot for the profiling event of the next enqueued kernel, NULL if not profiling */
+#define NEXT_EVENT(events)  ((events) ? &((events)->event[(events)->count++]) : NULL)
+
 /**
  *******************************************************************************
  *  @fn     runKernels
  *  @brief  This function runs the filter kenrel kernels
  *
  *  @param[in] oclQueue        : pointer to the ocl command queue
- *  @param[in] gaussianFilterKernel : pointer to the gaussian filter kernel
- *  @param[in] enhancedKernel : pointer to the enhanced filter kernel
- *  @param[in] combinedKernel : pointer to the enhanced combined kernel
+ *  @param[in] kernels         : kernels created by buildKernels
+ *  @param[in] config          : filter mode, work-group tile, rows and pixels
+ *                               per work-item, channel layout, whether to
+ *                               run the combined kernel, the persistent
+ *                               work-group count, the region of interest and
+ *                               the frames of a batched launch
  *  @param[in] width           : X dimension
  *  @param[in] height          : Y dimension
+ *  @param[out] events         : if not NULL, receives a profiling event per
+ *                               enqueued kernel, see kernelEventsTime
  *
  *  @return bool : true if successful; otherwise false.
  *******************************************************************************
  */
-bool runKernels(cl_command_queue oclQueue, cl_kernel gaussianFilterKernel,
-                cl_kernel enhancedKernel, cl_kernel combinedKernel, cl_int runCombinedKernel, 
-                cl_uint width, cl_uint height)
+bool runKernels(cl_command_queue oclQueue, filterKernels *kernels,
+                filterConfig *config, cl_uint width, cl_uint height,
+                kernelEvents *events)
 {
     cl_int err;
-    size_t localWorkSize[2] = { LOCAL_XRES, LOCAL_YRES };
-    size_t globalWorkSize[2];
+    size_t localWorkSize[3] = { config->localXRes, config->localYRes, 1 };
+    size_t globalWorkSize[3];
+
+    /* The planar kernels stack the channel planes along dimension 1 */
+    if (config->channels > 1 && config->planar)
+        height *= config->channels;
 
     globalWorkSize[0] = (width + localWorkSize[0] - 1) / localWorkSize[0];
     globalWorkSize[0] *= localWorkSize[0];
     globalWorkSize[1] = (height + localWorkSize[1] - 1) / localWorkSize[1];
     globalWorkSize[1] *= localWorkSize[1];
 
-    if (runCombinedKernel)
+    /* The register-blocked kernels produce rowsPerItem rows per work-item and
+       the vectorized kernels vecWidth pixels per work-item */
+    size_t blockedGlobalWorkSize[3];
+    cl_uint blockedCols = (width + config->vecWidth - 1) / config->vecWidth;
+    cl_uint blockedRows = (height + config->rowsPerItem - 1) / config->rowsPerItem;
+    blockedGlobalWorkSize[0] = (blockedCols + localWorkSize[0] - 1) / localWorkSize[0];
+    blockedGlobalWorkSize[0] *= localWorkSize[0];
+    blockedGlobalWorkSize[1] = (blockedRows + localWorkSize[1] - 1) / localWorkSize[1];
+    blockedGlobalWorkSize[1] *= localWorkSize[1];
+
+    size_t enhanceGlobalWorkSize[3] = { blockedGlobalWorkSize[0], globalWorkSize[1], 1 };
+
+    /* A batch adds the frame index as dimension 2 of the direct launches, all
+       frames are filtered by one enqueue */
+    cl_uint directWorkDim = config->batched ? 3 : 2;
+    globalWorkSize[2] = blockedGlobalWorkSize[2] = enhanceGlobalWorkSize[2] =
+                    config->batched ? config->frames : 1;
+
+    /* The strip kernels walk STRIP_WIDTH x STRIP_ROWS outputs per work-item and
+       leave the work-group size to the runtime */
+    size_t stripGlobalWorkSize[3] = { (width + STRIP_WIDTH - 1) / STRIP_WIDTH,
+                    (height + STRIP_ROWS - 1) / STRIP_ROWS, 1 };
+    size_t *directGlobalWorkSize = config->strip ? stripGlobalWorkSize : blockedGlobalWorkSize;
+    size_t *directLocalWorkSize = config->strip ? NULL : localWorkSize;
+
+    /* A region of interest is launched over its own rectangle. The global work
+       offset keeps the kernels indexing the full-size buffers */
+    size_t roiWorkOffset[3] = { config->roi.x, config->roi.y, 0 };
+    size_t *globalWorkOffset = NULL;
+    if (config->roi.width)
     {
-        err = clEnqueueNDRangeKernel(oclQueue, combinedKernel, 2, NULL,
-                        globalWorkSize, localWorkSize, 0, NULL, NULL);
+        globalWorkOffset = roiWorkOffset;
+        globalWorkSize[0] = (config->roi.width + localWorkSize[0] - 1) / localWorkSize[0];
+        globalWorkSize[0] *= localWorkSize[0];
+        globalWorkSize[1] = (config->roi.height + localWorkSize[1] - 1) / localWorkSize[1];
+        globalWorkSize[1] *= localWorkSize[1];
+        blockedGlobalWorkSize[0] = enhanceGlobalWorkSize[0] = globalWorkSize[0];
+        blockedGlobalWorkSize[1] = enhanceGlobalWorkSize[1] = globalWorkSize[1];
+    }
+
+    if (config->filterMode == FILTER_MODE_RECURSIVE || config->filterMode == FILTER_MODE_BOX)
+    {
+        /* One work-item per row, then one per column. The output feeds the
+           regular enhance kernel */
+        size_t recursiveLocalWorkSize = RECURSIVE_LOCAL_SIZE;
+        size_t rowGlobalWorkSize = (height + recursiveLocalWorkSize - 1) / recursiveLocalWorkSize;
+        rowGlobalWorkSize *= recursiveLocalWorkSize;
+        size_t colGlobalWorkSize = (width + recursiveLocalWorkSize - 1) / recursiveLocalWorkSize;
+        colGlobalWorkSize *= recursiveLocalWorkSize;
+
+        err = clEnqueueNDRangeKernel(oclQueue, kernels->rowKernel, 1, NULL,
+                        &rowGlobalWorkSize, &recursiveLocalWorkSize, 0, NULL, NEXT_EVENT(events));
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clEnqueueNDRangeKernel failed with Error code = %d", err);
+
+        err = clEnqueueNDRangeKernel(oclQueue, kernels->colKernel, 1, NULL,
+                        &colGlobalWorkSize, &recursiveLocalWorkSize, 0, NULL, NEXT_EVENT(events));
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clEnqueueNDRangeKernel failed with Error code = %d", err);
+
+        if (config->outputSelect != OUTPUT_GAUSSIAN)
+        {
+            err = clEnqueueNDRangeKernel(oclQueue, kernels->enhancedKernel, 2, NULL,
+                            enhanceGlobalWorkSize, localWorkSize, 0, NULL, NEXT_EVENT(events));
+            CHECK_RESULT(err != CL_SUCCESS,
+                            "clEnqueueNDRangeKernel failed with Error code = %d", err);
+        }
+    }
+    else if (config->persistent)
+    {
+        /* One work-group per compute unit, the tiles of all frames are pulled
+           from the tile counter */
+        size_t persistentGlobalWorkSize[2] = { config->persistentGroups * localWorkSize[0],
+                        localWorkSize[1] };
+
+        err = clEnqueueNDRangeKernel(oclQueue, kernels->combinedKernel, 2, NULL,
+                        persistentGlobalWorkSize, localWorkSize, 0, NULL, NEXT_EVENT(events));
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clEnqueueNDRangeKernel failed with Error code = %d", err);
+    }
+    else if (config->runCombinedKernel)
+    {
+        err = clEnqueueNDRangeKernel(oclQueue, kernels->combinedKernel, directWorkDim, globalWorkOffset,
+                        (config->filterMode == FILTER_MODE_SEPARABLE) ? globalWorkSize : directGlobalWorkSize,
+                        (config->filterMode == FILTER_MODE_SEPARABLE) ? localWorkSize : directLocalWorkSize,
+                        0, NULL, NEXT_EVENT(events));
         CHECK_RESULT(err != CL_SUCCESS,
                         "clEnqueueNDRangeKernel failed with Error code = %d", err);
     }
     else
     {
-        err = clEnqueueNDRangeKernel(oclQueue, gaussianFilterKernel, 2, NULL,
+        if (config->filterMode == FILTER_MODE_SEPARABLE)
+        {
+            /* The horizontal pass also covers the filtSize - 1 halo rows */
+            size_t rowGlobalWorkSize[2];
+            rowGlobalWorkSize[0] = globalWorkSize[0];
+            rowGlobalWorkSize[1] = (height + config->filtSize - 1 + localWorkSize[1] - 1) / localWorkSize[1];
+            rowGlobalWorkSize[1] *= localWorkSize[1];
+
+            err = clEnqueueNDRangeKernel(oclQueue, kernels->rowKernel, 2, NULL,
+                            rowGlobalWorkSize, localWorkSize, 0, NULL, NEXT_EVENT(events));
+            CHECK_RESULT(err != CL_SUCCESS,
+                            "clEnqueueNDRangeKernel failed with Error code = %d", err);
+
+            err = clEnqueueNDRangeKernel(oclQueue, kernels->colKernel, 2, NULL,
+                            globalWorkSize, localWorkSize, 0, NULL, NEXT_EVENT(events));
+            CHECK_RESULT(err != CL_SUCCESS,
+                            "clEnqueueNDRangeKernel failed with Error code = %d", err);
+        }
+        else
+        {
+            err = clEnqueueNDRangeKernel(oclQueue, kernels->gaussianKernel, directWorkDim, globalWorkOffset,
+                            directGlobalWorkSize, directLocalWorkSize, 0, NULL, NEXT_EVENT(events));
+            CHECK_RESULT(err != CL_SUCCESS,
+                            "clEnqueueNDRangeKernel failed with Error code = %d", err);
+        }
+
+        if (config->outputSelect != OUTPUT_GAUSSIAN)
+        {
+            err = clEnqueueNDRangeKernel(oclQueue, kernels->enhancedKernel, directWorkDim, globalWorkOffset,
+                            enhanceGlobalWorkSize, localWorkSize, 0, NULL, NEXT_EVENT(events));
+            CHECK_RESULT(err != CL_SUCCESS,
+                            "clEnqueueNDRangeKernel failed with Error code = %d", err);
+        }
+    }
+
+    return true;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     runPyramid
+ *  @brief  This function builds the Gaussian pyramid levels below the input.
+ *          Each level is blurred and decimated by 2 in one pass that only
+ *          computes the retained pixels. Once a level fits in PYRAMID_LDS_DIM
+ *          x PYRAMID_LDS_DIM, one work-group builds all remaining levels from
+ *          local memory
+ *
+ *  @param[in] oclQueue        : pointer to the ocl command queue
+ *  @param[in] kernels         : kernels created by buildKernels
+ *  @param[in] buffers         : input, pyramid and coefficient buffers
+ *  @param[in] config          : pyramid levels, work-group tile, filter size
+ *                               and border mode of the input
+ *  @param[in] width           : X dimension of the input
+ *  @param[in] height          : Y dimension of the input
+ *
+ *  @return bool : true if successful; otherwise false.
+ *******************************************************************************
+ */
+bool runPyramid(cl_command_queue oclQueue, filterKernels *kernels,
+                filterBuffers *buffers, filterConfig *config,
+                cl_uint width, cl_uint height)
+{
+    cl_int err = CL_SUCCESS;
+    size_t localWorkSize[2] = { config->localXRes, config->localYRes };
+    pyramidLayout layout;
+
+    computePyramidLayout(width, height, config->pyramidLevels, &layout);
+
+    /* Level 0 is the input buffer, read inside its padding if it has one */
+    cl_uint extWidth = width + config->filtSize - 1;
+    if (config->borderMode != BORDER_MODE_HOST_PAD)
+        extWidth = width;
+
+    for (cl_uint level = 1; level <= config->pyramidLevels; level++)
+    {
+        cl_mem src = (level == 1) ? buffers->input : buffers->pyramid;
+        cl_uint srcBase = (level == 1) ? 0 : (cl_uint)layout.base[level - 1];
+        cl_uint srcPitch = (level == 1) ? extWidth : layout.width[level - 1];
+        cl_uint srcPad = (level == 1) ? (extWidth - width) / 2 : 0;
+        cl_uint dstBase = (cl_uint)layout.base[level];
+        cl_uint levels = config->pyramidLevels - level + 1;
+
+        bool fitsLds = layout.width[level - 1] <= PYRAMID_LDS_DIM &&
+                        layout.height[level - 1] <= PYRAMID_LDS_DIM;
+        cl_kernel kernel = fitsLds ? kernels->pyramidLdsKernel : kernels->pyramidKernel;
+
+        int cnt = 0;
+        err  = clSetKernelArg(kernel, cnt++, sizeof(cl_mem), &src);
+        err |= clSetKernelArg(kernel, cnt++, sizeof(cl_uint), &srcBase);
+        err |= clSetKernelArg(kernel, cnt++, sizeof(cl_uint), &(layout.width[level - 1]));
+        err |= clSetKernelArg(kernel, cnt++, sizeof(cl_uint), &(layout.height[level - 1]));
+        err |= clSetKernelArg(kernel, cnt++, sizeof(cl_uint), &srcPitch);
+        err |= clSetKernelArg(kernel, cnt++, sizeof(cl_uint), &srcPad);
+        err |= clSetKernelArg(kernel, cnt++, sizeof(cl_mem), &(buffers->pyramid));
+        err |= clSetKernelArg(kernel, cnt++, sizeof(cl_uint), &dstBase);
+        if (fitsLds)
+            err |= clSetKernelArg(kernel, cnt++, sizeof(cl_uint), &levels);
+        err |= clSetKernelArg(kernel, cnt++, sizeof(cl_mem), &(buffers->filterCoeff));
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clSetKernelArg failed with Error code = %d", err);
+
+        if (fitsLds)
+        {
+            err = clEnqueueNDRangeKernel(oclQueue, kernel, 2, NULL,
+                            localWorkSize, localWorkSize, 0, NULL, NULL);
+            CHECK_RESULT(err != CL_SUCCESS,
+                            "clEnqueueNDRangeKernel failed with Error code = %d", err);
+            break;
+        }
+
+        size_t globalWorkSize[2];
+        globalWorkSize[0] = (layout.width[level] + localWorkSize[0] - 1) / localWorkSize[0];
+        globalWorkSize[0] *= localWorkSize[0];
+        globalWorkSize[1] = (layout.height[level] + localWorkSize[1] - 1) / localWorkSize[1];
+        globalWorkSize[1] *= localWorkSize[1];
+
+        err = clEnqueueNDRangeKernel(oclQueue, kernel, 2, NULL,
                         globalWorkSize, localWorkSize, 0, NULL, NULL);
         CHECK_RESULT(err != CL_SUCCESS,
                         "clEnqueueNDRangeKernel failed with Error code = %d", err);
+    }
+
+    return true;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     runLaplacianEnhance
+ *  @brief  This function enhances the input through the Laplacian pyramid of
+ *          the levels built by runPyramid. Coarsest first, each launch expands
+ *          the collapsed level below, adds the gained difference between its
+ *          Gaussian level and the expanded next one, and stores the result.
+ *          Level 0 goes to the enhanced output
+ *
+ *  @param[in] oclQueue        : pointer to the ocl command queue
+ *  @param[in] kernels         : kernels created by buildKernels
+ *  @param[in] buffers         : input, pyramid, collapse, enhanced output and
+ *                               coefficient buffers
+ *  @param[in] config          : pyramid levels, detail gains, work-group tile,
+ *                               filter size and border mode of the input
+ *  @param[in] width           : X dimension of the input
+ *  @param[in] height          : Y dimension of the input
+ *
+ *  @return bool : true if successful; otherwise false.
+ *******************************************************************************
+ */
+bool runLaplacianEnhance(cl_command_queue oclQueue, filterKernels *kernels,
+                filterBuffers *buffers, filterConfig *config,
+                cl_uint width, cl_uint height)
+{
+    cl_int err = CL_SUCCESS;
+    size_t localWorkSize[2] = { config->localXRes, config->localYRes };
+    pyramidLayout layout;
+
+    computePyramidLayout(width, height, config->pyramidLevels, &layout);
 
-        err = clEnqueueNDRangeKernel(oclQueue, enhancedKernel, 2, NULL,
+    /* Level 0 is the input buffer, read inside its padding if it has one */
+    cl_uint extWidth = width + config->filtSize - 1;
+    if (config->borderMode != BORDER_MODE_HOST_PAD)
+        extWidth = width;
+
+    for (cl_int level = config->pyramidLevels - 1; level >= 0; level--)
+    {
+        cl_mem src = (level == 0) ? buffers->input : buffers->pyramid;
+        cl_uint srcBase = (level == 0) ? 0 : (cl_uint)layout.base[level];
+        cl_uint srcPitch = (level == 0) ? extWidth : layout.width[level];
+        cl_uint srcPad = (level == 0) ? (extWidth - width) / 2 : 0;
+        cl_uint coarseBase = (cl_uint)layout.base[level + 1];
+        cl_uint outBase = (cl_uint)layout.base[level];
+        cl_uint coarsest = (level + 1 == (cl_int)config->pyramidLevels);
+        cl_uint finest = (level == 0);
+
+        int cnt = 0;
+        err  = clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_mem), &src);
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &srcBase);
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &(layout.width[level]));
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &(layout.height[level]));
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &srcPitch);
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &srcPad);
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_mem), &(buffers->pyramid));
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_mem), &(buffers->collapse));
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &coarseBase);
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &outBase);
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &coarsest);
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_uint), &finest);
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_float), &(config->detailGain[level]));
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_mem), &(buffers->enhancedOutput));
+        err |= clSetKernelArg(kernels->collapseKernel, cnt++, sizeof(cl_mem), &(buffers->filterCoeff));
+        CHECK_RESULT(err != CL_SUCCESS,
+                        "clSetKernelArg failed with Error code = %d", err);
+
+        size_t globalWorkSize[2];
+        globalWorkSize[0] = (layout.width[level] + localWorkSize[0] - 1) / localWorkSize[0];
+        globalWorkSize[0] *= localWorkSize[0];
+        globalWorkSize[1] = (layout.height[level] + localWorkSize[1] - 1) / localWorkSize[1];
+        globalWorkSize[1] *= localWorkSize[1];
+
+        err = clEnqueueNDRangeKernel(oclQueue, kernels->collapseKernel, 2, NULL,
                         globalWorkSize, localWorkSize, 0, NULL, NULL);
         CHECK_RESULT(err != CL_SUCCESS,
                         "clEnqueueNDRangeKernel failed with Error code = %d", err);
@@ -236,3 +835,957 @@ bool runKernels(cl_command_queue oclQueue, cl_kernel gaussianFilterKernel,
 
     return true;
 }
+
+/**
+ *******************************************************************************
+ *  @fn     runBoxMean
+ *  @brief  This function builds the summed-area table of the input with a row
+ *          scan and a column scan, then computes the box mean of satRadius, or
+ *          of the per-pixel radius map, in O(1) per pixel
+ *
+ *  @param[in] oclQueue        : pointer to the ocl command queue
+ *  @param[in] kernels         : kernels created by buildKernels
+ *  @param[in] buffers         : input, summed-area table, radius map and box
+ *                               mean output buffers
+ *  @param[in] config          : box radius, radius map switch, work-group
+ *                               tile, filter size and border mode of the input
+ *  @param[in] width           : X dimension of the input
+ *  @param[in] height          : Y dimension of the input
+ *
+ *  @return bool : true if successful; otherwise false.
+ *******************************************************************************
+ */
+bool runBoxMean(cl_command_queue oclQueue, filterKernels *kernels,
+                filterBuffers *buffers, filterConfig *config,
+                cl_uint width, cl_uint height)
+{
+    cl_int err = CL_SUCCESS;
+    size_t localWorkSize[2] = { config->localXRes, config->localYRes };
+
+    /* The scan reads the input inside its padding if it has one */
+    cl_uint extWidth = width + config->filtSize - 1;
+    if (config->borderMode != BORDER_MODE_HOST_PAD)
+        extWidth = width;
+    cl_uint srcPad = (extWidth - width) / 2;
+    cl_uint useMap = (config->radiusMap != 0);
+
+    int cnt = 0;
+    err  = clSetKernelArg(kernels->satRowKernel, cnt++, sizeof(cl_mem), &(buffers->input));
+    err |= clSetKernelArg(kernels->satRowKernel, cnt++, sizeof(cl_mem), &(buffers->sat));
+    err |= clSetKernelArg(kernels->satRowKernel, cnt++, sizeof(cl_uint), &width);
+    err |= clSetKernelArg(kernels->satRowKernel, cnt++, sizeof(cl_uint), &height);
+    err |= clSetKernelArg(kernels->satRowKernel, cnt++, sizeof(cl_uint), &extWidth);
+    err |= clSetKernelArg(kernels->satRowKernel, cnt++, sizeof(cl_uint), &srcPad);
+
+    cnt = 0;
+    err |= clSetKernelArg(kernels->satColKernel, cnt++, sizeof(cl_mem), &(buffers->sat));
+    err |= clSetKernelArg(kernels->satColKernel, cnt++, sizeof(cl_uint), &width);
+    err |= clSetKernelArg(kernels->satColKernel, cnt++, sizeof(cl_uint), &height);
+
+    cnt = 0;
+    err |= clSetKernelArg(kernels->boxMeanKernel, cnt++, sizeof(cl_mem), &(buffers->sat));
+    err |= clSetKernelArg(kernels->boxMeanKernel, cnt++, sizeof(cl_mem), &(buffers->radiusMap));
+    err |= clSetKernelArg(kernels->boxMeanKernel, cnt++, sizeof(cl_mem), &(buffers->boxMeanOutput));
+    err |= clSetKernelArg(kernels->boxMeanKernel, cnt++, sizeof(cl_uint), &width);
+    err |= clSetKernelArg(kernels->boxMeanKernel, cnt++, sizeof(cl_uint), &height);
+    err |= clSetKernelArg(kernels->boxMeanKernel, cnt++, sizeof(cl_uint), &(config->satRadius));
+    err |= clSetKernelArg(kernels->boxMeanKernel, cnt++, sizeof(cl_uint), &useMap);
+    CHECK_RESULT(err != CL_SUCCESS,
+                    "clSetKernelArg failed with Error code = %d", err);
+
+    /* One work-group per row, then one work-item per column */
+    size_t scanLocalWorkSize = SAT_SCAN_SIZE;
+    size_t rowGlobalWorkSize = height * scanLocalWorkSize;
+    size_t colGlobalWorkSize = (width + scanLocalWorkSize - 1) / scanLocalWorkSize;
+    colGlobalWorkSize *= scanLocalWorkSize;
+
+    err = clEnqueueNDRangeKernel(oclQueue, kernels->satRowKernel, 1, NULL,
+                    &rowGlobalWorkSize, &scanLocalWorkSize, 0, NULL, NULL);
+    CHECK_RESULT(err != CL_SUCCESS,
+                    "clEnqueueNDRangeKernel failed with Error code = %d", err);
+
+    err = clEnqueueNDRangeKernel(oclQueue, kernels->satColKernel, 1, NULL,
+                    &colGlobalWorkSize, &scanLocalWorkSize, 0, NULL, NULL);
+    CHECK_RESULT(err != CL_SUCCESS,
+                    "clEnqueueNDRangeKernel failed with Error code = %d", err);
+
+    size_t globalWorkSize[2];
+    globalWorkSize[0] = (width + localWorkSize[0] - 1) / localWorkSize[0];
+    globalWorkSize[0] *= localWorkSize[0];
+    globalWorkSize[1] = (height + localWorkSize[1] - 1) / localWorkSize[1];
+    globalWorkSize[1] *= localWorkSize[1];
+
+    err = clEnqueueNDRangeKernel(oclQueue, kernels->boxMeanKernel, 2, NULL,
+                    globalWorkSize, localWorkSize, 0, NULL, NULL);
+    CHECK_RESULT(err != CL_SUCCESS,
+                    "clEnqueueNDRangeKernel failed with Error code = %d", err);
+
+    return true;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     releaseKernels
+ *  @brief  This function releases the kernels created by buildKernels
+ *
+ *  @param[in] kernels         : kernels created by buildKernels
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void releaseKernels(filterKernels *kernels)
+{
+    if (kernels->gaussianKernel)
+        clReleaseKernel(kernels->gaussianKernel);
+    if (kernels->enhancedKernel)
+        clReleaseKernel(kernels->enhancedKernel);
+    if (kernels->combinedKernel)
+        clReleaseKernel(kernels->combinedKernel);
+    if (kernels->rowKernel)
+        clReleaseKernel(kernels->rowKernel);
+    if (kernels->colKernel)
+        clReleaseKernel(kernels->colKernel);
+    if (kernels->pyramidKernel)
+        clReleaseKernel(kernels->pyramidKernel);
+    if (kernels->pyramidLdsKernel)
+        clReleaseKernel(kernels->pyramidLdsKernel);
+    if (kernels->collapseKernel)
+        clReleaseKernel(kernels->collapseKernel);
+    if (kernels->satRowKernel)
+        clReleaseKernel(kernels->satRowKernel);
+    if (kernels->satColKernel)
+        clReleaseKernel(kernels->satColKernel);
+    if (kernels->boxMeanKernel)
+        clReleaseKernel(kernels->boxMeanKernel);
+}
+
+/**
+ *******************************************************************************
+ *  @fn     kernelEventsTime
+ *  @brief  This function waits for the kernels recorded by runKernels and
+ *          returns their summed execution time. The events are released
+ *
+ *  @param[in/out] events      : events filled by runKernels
+ *
+ *  @return cl_double : kernel time in msec
+ *******************************************************************************
+ */
+cl_double kernelEventsTime(kernelEvents *events)
+{
+    cl_double time_ms = 0.0;
+
+    if (events->count)
+        clWaitForEvents(events->count, events->event);
+
+    for (cl_uint i = 0; i < events->count; i++)
+    {
+        cl_ulong start = 0, end = 0;
+        clGetEventProfilingInfo(events->event[i], CL_PROFILING_COMMAND_START,
+                        sizeof(cl_ulong), &start, NULL);
+        clGetEventProfilingInfo(events->event[i], CL_PROFILING_COMMAND_END,
+                        sizeof(cl_ulong), &end, NULL);
+        time_ms += (end - start) * 1e-6;
+        clReleaseEvent(events->event[i]);
+    }
+    events->count = 0;
+
+    return time_ms;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     kernelsWorkGroupSize
+ *  @brief  This function returns the largest work-group size every created
+ *          kernel can be launched with on the device
+ *
+ *  @param[in] kernels         : kernels created by buildKernels
+ *  @param[in] oclDevice       : device the kernels were built for
+ *
+ *  @return size_t : work-group size limit
+ *******************************************************************************
+ */
+size_t kernelsWorkGroupSize(filterKernels *kernels, cl_device_id oclDevice)
+{
+    cl_kernel list[] = { kernels->gaussianKernel, kernels->enhancedKernel,
+                    kernels->combinedKernel, kernels->rowKernel, kernels->colKernel,
+                    kernels->pyramidKernel, kernels->pyramidLdsKernel, kernels->collapseKernel,
+                    kernels->boxMeanKernel };
+    size_t limit = (size_t)-1;
+
+    for (cl_uint i = 0; i < sizeof(list) / sizeof(list[0]); i++)
+    {
+        size_t size = 0;
+        if (list[i] && clGetKernelWorkGroupInfo(list[i], oclDevice, CL_KERNEL_WORK_GROUP_SIZE,
+                        sizeof(size_t), &size, NULL) == CL_SUCCESS && size < limit)
+            limit = size;
+    }
+
+    return limit;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     deviceHasExtension
+ *  @brief  This function checks CL_DEVICE_EXTENSIONS for an extension name
+ *
+ *  @param[in] oclDevice       : device to query
+ *  @param[in] extension       : extension name, e.g. "cl_khr_fp16"
+ *
+ *  @return bool : true if the device reports the extension; otherwise false.
+ *******************************************************************************
+ */
+bool deviceHasExtension(cl_device_id oclDevice, const char *extension)
+{
+    size_t size = 0;
+    bool found = false;
+
+    if (clGetDeviceInfo(oclDevice, CL_DEVICE_EXTENSIONS, 0, NULL, &size) != CL_SUCCESS || size == 0)
+        return false;
+
+    char *extensions = (char *) malloc(size + 1);
+    if (extensions == NULL)
+        return false;
+    clGetDeviceInfo(oclDevice, CL_DEVICE_EXTENSIONS, size, extensions, NULL);
+    extensions[size] = '\0';
+
+    /* Whole, space separated names only */
+    size_t len = strlen(extension);
+    for (char *pos = strstr(extensions, extension); pos; pos = strstr(pos + 1, extension))
+    {
+        if ((pos == extensions || pos[-1] == ' ') && (pos[len] == ' ' || pos[len] == '\0'))
+        {
+            found = true;
+            break;
+        }
+    }
+
+    free(extensions);
+    return found;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     subgroupShuffleExt
+ *  @brief  This function picks the sub-group shuffle extension the shuffle
+ *          kernels are built against
+ *
+ *  @param[in] oclDevice       : device to query
+ *
+ *  @return cl_int : SUBGROUP_EXT_KHR, SUBGROUP_EXT_INTEL or SUBGROUP_EXT_NONE
+ *******************************************************************************
+ */
+cl_int subgroupShuffleExt(cl_device_id oclDevice)
+{
+    if (deviceHasExtension(oclDevice, "cl_khr_subgroups") &&
+        deviceHasExtension(oclDevice, "cl_khr_subgroup_shuffle"))
+        return SUBGROUP_EXT_KHR;
+
+    if (deviceHasExtension(oclDevice, "cl_intel_subgroups"))
+        return SUBGROUP_EXT_INTEL;
+
+    return SUBGROUP_EXT_NONE;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     storedChannels
+ *  @brief  This function returns the samples stored per pixel. Interleaved RGB
+ *          is stored as 4 channels so every pixel is one uchar4 or ushort4
+ *
+ *  @param[in] config          : channel count and layout
+ *
+ *  @return cl_uint : 1, 3 or 4
+ *******************************************************************************
+ */
+cl_uint storedChannels(const filterConfig *config)
+{
+    if (config->channels > 1 && !config->planar)
+        return 4;
+    return config->channels;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     packedBits
+ *  @brief  This function tells whether a bit width is uploaded packed. 10 and
+ *          12 bit pixels are sent as a bitstream and unpacked by the kernels,
+ *          the outputs are ushort
+ *
+ *  @param[in] bitWidth        : bits per pixel
+ *
+ *  @return cl_uint : 10 or 12, 0 if the input is not packed
+ *******************************************************************************
+ */
+cl_uint packedBits(cl_uint bitWidth)
+{
+    return (bitWidth == 10 || bitWidth == 12) ? bitWidth : 0;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     packedRowBytes
+ *  @brief  This function returns the bytes of one packed row. Each row starts
+ *          on a byte, matching PACKED_PITCH in the kernels
+ *
+ *  @param[in] width           : pixels per row
+ *  @param[in] bits            : bits per pixel
+ *
+ *  @return size_t : row pitch in bytes
+ *******************************************************************************
+ */
+size_t packedRowBytes(cl_uint width, cl_uint bits)
+{
+    return ((size_t)width * bits + 7) / 8;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     packPixels
+ *  @brief  This function packs pixels into a little-endian bitstream: pixel k
+ *          takes bits k * bits to (k + 1) * bits - 1, counted from bit 0 of
+ *          byte 0. This is the layout unpackRow reads on the device
+ *
+ *  @param[in] src             : pixels, only the low bits are kept
+ *  @param[in] count           : number of pixels
+ *  @param[in] bits            : bits per pixel, up to 16
+ *  @param[out] dst            : packedRowBytes(count, bits) bytes
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void packPixels(const cl_ushort *src, cl_uint count, cl_uint bits, cl_uchar *dst)
+{
+    cl_uint acc = 0;
+    cl_uint accBits = 0;
+    cl_uint mask = (1u << bits) - 1;
+
+    for (cl_uint k = 0; k < count; k++)
+    {
+        acc |= (src[k] & mask) << accBits;
+        accBits += bits;
+        while (accBits >= 8)
+        {
+            *dst++ = (cl_uchar)acc;
+            acc >>= 8;
+            accBits -= 8;
+        }
+    }
+
+    if (accBits)
+        *dst = (cl_uchar)acc;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     computePyramidLayout
+ *  @brief  This function computes the size of every pyramid level and where it
+ *          starts in the pyramid buffer. A level keeps the even rows and
+ *          columns of the one above, so odd sizes round up
+ *
+ *  @param[in] width           : input image width
+ *  @param[in] height          : input image height
+ *  @param[in] levels          : levels below the input, at most MAX_PYRAMID_LEVELS
+ *  @param[out] layout         : level sizes, offsets and the total size
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void computePyramidLayout(cl_uint width, cl_uint height, cl_uint levels,
+                pyramidLayout *layout)
+{
+    memset(layout, 0, sizeof(pyramidLayout));
+    layout->width[0] = width;
+    layout->height[0] = height;
+
+    for (cl_uint level = 1; level <= levels; level++)
+    {
+        layout->width[level] = (layout->width[level - 1] + 1) / 2;
+        layout->height[level] = (layout->height[level - 1] + 1) / 2;
+        layout->base[level] = layout->size;
+        layout->size += (size_t)layout->width[level] * layout->height[level];
+    }
+}
+
+/**
+ *******************************************************************************
+ *  @fn     sampleIndex
+ *  @brief  This function returns the index of a sample in an image stored
+ *          with the configured channel layout
+ *
+ *  @param[in] config          : channel count and layout
+ *  @param[in] channel         : channel of the sample
+ *  @param[in] x               : column
+ *  @param[in] y               : row
+ *  @param[in] width           : image width in pixels, including any padding
+ *  @param[in] height          : image height in pixels, including any padding
+ *
+ *  @return size_t : index in samples
+ *******************************************************************************
+ */
+size_t sampleIndex(const filterConfig *config, cl_uint channel, cl_uint x, cl_uint y,
+                cl_uint width, cl_uint height)
+{
+    if (config->channels == 1)
+        return (size_t)y * width + x;
+    if (config->planar)
+        return ((size_t)channel * height + y) * width + x;
+    return ((size_t)y * width + x) * 4 + channel;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     generateGaussianCoeff
+ *  @brief  This function computes normalized Gaussian coefficients for any
+ *          filter size and sigma
+ *
+ *  @param[in] filtSize        : Filter size (odd), radius is filtSize / 2
+ *  @param[in] sigma           : Gaussian sigma. If <= 0, the sigma usually paired
+ *                               with filtSize (0.3 * ((filtSize - 1) / 2 - 1) + 0.8)
+ *                               is used
+ *  @param[out] coeff1D        : filtSize 1D coefficients summing to 1
+ *  @param[out] coeff2D        : filtSize x filtSize coefficients, the outer
+ *                               product of coeff1D
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void generateGaussianCoeff(cl_uint filtSize, cl_float sigma,
+                cl_float *coeff1D, cl_float *coeff2D)
+{
+    cl_int radius = filtSize / 2;
+    double sum = 0.0;
+
+    if (sigma <= 0.0f)
+        sigma = 0.3f * ((filtSize - 1) * 0.5f - 1.0f) + 0.8f;
+
+    for (cl_int i = -radius; i <= radius; i++)
+    {
+        coeff1D[i + radius] = (cl_float) exp(-(double)(i * i) / (2.0 * sigma * sigma));
+        sum += coeff1D[i + radius];
+    }
+
+    for (cl_uint i = 0; i < filtSize; i++)
+        coeff1D[i] = (cl_float)(coeff1D[i] / sum);
+
+    for (cl_uint i = 0; i < filtSize; i++)
+        for (cl_uint j = 0; j < filtSize; j++)
+            coeff2D[i * filtSize + j] = coeff1D[i] * coeff1D[j];
+}
+
+/**
+ *******************************************************************************
+ *  @fn     computeRecursiveCoeff
+ *  @brief  This function computes the coefficients of the Young / van Vliet
+ *          recursive Gaussian filter
+ *
+ *  @param[in] sigma           : Gaussian sigma, at least RECURSIVE_MIN_SIGMA
+ *  @param[out] coeff          : (B, b1/b0, b2/b0, b3/b0) where
+ *                               w[n] = B*x[n] + (b1*w[n-1] + b2*w[n-2] + b3*w[n-3]) / b0
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void computeRecursiveCoeff(cl_float sigma, cl_float4 *coeff)
+{
+    double q;
+
+    if (sigma >= 2.5f)
+        q = 0.98711 * sigma - 0.96330;
+    else
+        q = 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+    double b1 = 2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q;
+    double b2 = -(1.4281 * q * q + 1.26661 * q * q * q);
+    double b3 = 0.422205 * q * q * q;
+
+    coeff->s[0] = (cl_float)(1.0 - (b1 + b2 + b3) / b0);
+    coeff->s[1] = (cl_float)(b1 / b0);
+    coeff->s[2] = (cl_float)(b2 / b0);
+    coeff->s[3] = (cl_float)(b3 / b0);
+}
+
+/**
+ *******************************************************************************
+ *  @fn     computeBoxRadii
+ *  @brief  This function picks the radii of BOX_PASSES box blurs whose
+ *          combined variance is closest to sigma^2. The ideal odd width
+ *          sqrt(12 sigma^2 / n + 1) is rounded down and up, and the passes
+ *          are split between the two widths
+ *
+ *  @param[in] sigma           : Gaussian sigma
+ *  @param[out] radii          : BOX_PASSES box radii, smaller ones first
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void computeBoxRadii(cl_float sigma, cl_uint *radii)
+{
+    double variance = 12.0 * sigma * sigma;
+    cl_int lower = (cl_int)floor(sqrt(variance / BOX_PASSES + 1.0));
+    if (lower % 2 == 0)
+        lower--;
+    if (lower < 1)
+        lower = 1;
+
+    /* Passes of width lower, the rest is lower + 2 */
+    double ideal = (variance - BOX_PASSES * lower * lower - 4.0 * BOX_PASSES * lower - 3.0 * BOX_PASSES)
+                    / (-4.0 * lower - 4.0);
+    cl_int numLower = (cl_int)floor(ideal + 0.5);
+
+    for (cl_int i = 0; i < BOX_PASSES; i++)
+        radii[i] = ((i < numLower) ? lower - 1 : lower + 1) / 2;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     satIsWide
+ *  @brief  This function tells whether the summed-area table needs ulong
+ *          entries. Window sums are taken modulo 2^32, which is exact as long
+ *          as the largest window of satRadius cannot reach 2^32
+ *
+ *  @param[in] config          : box-mean radius and bits per pixel
+ *
+ *  @return bool : true for ulong entries, false for uint
+ *******************************************************************************
+ */
+bool satIsWide(const filterConfig *config)
+{
+    double window = 2.0 * config->satRadius + 1.0;
+    double maxPixel = (double)((1u << config->bitWidth) - 1);
+
+    return window * window * maxPixel >= 4294967296.0;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     gaussianOutputNeeded
+ *  @brief  This function tells whether the Gaussian output buffer has to be
+ *          allocated. With OUTPUT_ENHANCED the combined kernels skip it, but
+ *          the separate and 1D pass paths still feed it to the enhance kernel
+ *
+ *  @param[in] config          : output selection, filter mode and kernel choice
+ *
+ *  @return bool : true if the buffer is written by a kernel
+ *******************************************************************************
+ */
+bool gaussianOutputNeeded(const filterConfig *config)
+{
+    bool combined = (config->persistent || config->runCombinedKernel)
+                    && config->filterMode != FILTER_MODE_RECURSIVE
+                    && config->filterMode != FILTER_MODE_BOX;
+
+    return config->outputSelect != OUTPUT_ENHANCED || !combined;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     roiOutputRect
+ *  @brief  This function gives the outputs written by a region of interest
+ *          launch. The launch starts at the ROI through the global work offset
+ *          and its size is rounded up to the work-group tile, but the kernels
+ *          built with ROI_END_X/Y store nothing past the ROI
+ *
+ *  @param[in] config          : region of interest and work-group tile
+ *  @param[in] width           : Image width
+ *  @param[in] height          : Image height
+ *  @param[out] rect           : Output rectangle, the whole image without ROI
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void roiOutputRect(const filterConfig *config, cl_uint width, cl_uint height,
+                roiRect *rect)
+{
+    if (config->roi.width == 0)
+    {
+        rect->x = 0;
+        rect->y = 0;
+        rect->width = width;
+        rect->height = height;
+        return;
+    }
+
+    rect->x = config->roi.x;
+    rect->y = config->roi.y;
+    rect->width = (config->roi.width < width - rect->x) ? config->roi.width : width - rect->x;
+    rect->height = (config->roi.height < height - rect->y) ? config->roi.height : height - rect->y;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     roiInputRect
+ *  @brief  This function gives the input read by a region of interest launch,
+ *          the output rectangle of roiOutputRect plus the filter halo. With
+ *          the host padding it is in padded coordinates, with a device-side
+ *          border the halo is clipped to the image
+ *
+ *  @param[in] config          : region of interest, filter size, border mode
+ *  @param[in] width           : Image width
+ *  @param[in] height          : Image height
+ *  @param[out] rect           : Input rectangle
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void roiInputRect(const filterConfig *config, cl_uint width, cl_uint height,
+                roiRect *rect)
+{
+    roiRect out;
+    roiOutputRect(config, width, height, &out);
+
+    if (config->borderMode == BORDER_MODE_HOST_PAD)
+    {
+        rect->x = out.x;
+        rect->y = out.y;
+        rect->width = out.width + config->filtSize - 1;
+        rect->height = out.height + config->filtSize - 1;
+        return;
+    }
+
+    cl_uint halo = config->filtSize / 2;
+    cl_uint endX = out.x + out.width + halo;
+    cl_uint endY = out.y + out.height + halo;
+
+    rect->x = (out.x > halo) ? out.x - halo : 0;
+    rect->y = (out.y > halo) ? out.y - halo : 0;
+    rect->width = ((endX < width) ? endX : width) - rect->x;
+    rect->height = ((endY < height) ? endY : height) - rect->y;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     boxGaussianError
+ *  @brief  This function compares the 2D kernel of the box approximation
+ *          with the exact Gaussian of sigma
+ *
+ *  @param[in] sigma           : Gaussian sigma
+ *  @param[in] radii           : BOX_PASSES box radii
+ *
+ *  @return cl_float : sum of the absolute differences of the 2D weights. A
+ *                     pixel can differ from the exact Gaussian by at most the
+ *                     maximum pixel value times this plus one rounding step
+ *******************************************************************************
+ */
+cl_float boxGaussianError(cl_float sigma, const cl_uint *radii)
+{
+    /* Wide enough for both the boxes and the Gaussian tails */
+    cl_int support = (cl_int)ceil(4.0f * sigma);
+    cl_int boxSupport = 0;
+    for (cl_uint i = 0; i < BOX_PASSES; i++)
+        boxSupport += radii[i];
+    if (boxSupport > support)
+        support = boxSupport;
+
+    cl_uint size = 2 * support + 1;
+    double *box = (double *) calloc(2 * size, sizeof(double));
+    double *gauss = box + size;
+    double *tmp = (double *) calloc(size, sizeof(double));
+    if (box == NULL || tmp == NULL)
+    {
+        free(box);
+        free(tmp);
+        return -1.0f;
+    }
+
+    /* Convolve the boxes starting from a unit impulse */
+    box[support] = 1.0;
+    for (cl_uint i = 0; i < BOX_PASSES; i++)
+    {
+        cl_int r = radii[i];
+        for (cl_int x = 0; x < (cl_int)size; x++)
+        {
+            double sum = 0.0;
+            for (cl_int k = x - r; k <= x + r; k++)
+                if (k >= 0 && k < (cl_int)size)
+                    sum += box[k];
+            tmp[x] = sum / (2 * r + 1);
+        }
+        memcpy(box, tmp, size * sizeof(double));
+    }
+
+    double sum = 0.0;
+    for (cl_int x = -support; x <= support; x++)
+    {
+        gauss[x + support] = exp(-(double)(x * x) / (2.0 * sigma * sigma));
+        sum += gauss[x + support];
+    }
+
+    double err = 0.0;
+    for (cl_uint y = 0; y < size; y++)
+        for (cl_uint x = 0; x < size; x++)
+            err += fabs(box[y] * box[x] - gauss[y] * gauss[x] / (sum * sum));
+
+    free(box);
+    free(tmp);
+    return (cl_float)err;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     isSymmetricCoeff
+ *  @brief  This function checks whether the coefficients are mirror symmetric
+ *          about the centre, so the kernels can add mirrored pixels first
+ *
+ *  @param[in] filtSize        : Filter size (odd)
+ *  @param[in] coeff1D         : filtSize 1D coefficients
+ *  @param[in] coeff2D         : filtSize x filtSize coefficients
+ *
+ *  @return bool : true if both tables are symmetric horizontally and
+ *                 vertically; otherwise false.
+ *******************************************************************************
+ */
+bool isSymmetricCoeff(cl_uint filtSize, const cl_float *coeff1D,
+                const cl_float *coeff2D)
+{
+    for (cl_uint i = 0; i < filtSize; i++)
+    {
+        if (coeff1D[i] != coeff1D[filtSize - 1 - i])
+            return false;
+
+        for (cl_uint j = 0; j < filtSize; j++)
+        {
+            cl_float c = coeff2D[i * filtSize + j];
+            if (c != coeff2D[i * filtSize + filtSize - 1 - j] ||
+                c != coeff2D[(filtSize - 1 - i) * filtSize + j])
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     halfPrecisionError
+ *  @brief  This function bounds the error of the half-precision kernels
+ *          against exact arithmetic. Each tap adds the rounding of its
+ *          coefficient to half, of the product and of the running sum, all
+ *          taken at the largest pixel value where they are largest
+ *
+ *  @param[in] count           : number of coefficients, in the kernels' order
+ *  @param[in] coeff           : float coefficients
+ *  @param[in] maxPixel        : largest pixel value
+ *
+ *  @return cl_float : worst-case absolute error of the sum in pixel levels,
+ *                     before the output is rounded
+ *******************************************************************************
+ */
+cl_float halfPrecisionError(cl_uint count, const cl_float *coeff, cl_float maxPixel)
+{
+    double err = 0.0;
+    double sum = 0.0;
+
+    for (cl_uint i = 0; i < count; i++)
+    {
+        /* half keeps 11 significant bits, the spacing stops at 2^-24 below
+           the normal range */
+        int exp;
+        frexp(coeff[i], &exp);
+        double step = ldexp(1.0, exp - 11 > -24 ? exp - 11 : -24);
+        double coeffHalf = rint(coeff[i] / step) * step;
+        err += maxPixel * fabs(coeffHalf - coeff[i]);
+
+        double product = maxPixel * coeffHalf;
+        frexp(product, &exp);
+        err += 0.5 * ldexp(1.0, exp - 11 > -24 ? exp - 11 : -24);
+
+        sum += product;
+        frexp(sum, &exp);
+        err += 0.5 * ldexp(1.0, exp - 11 > -24 ? exp - 11 : -24);
+    }
+
+    return (cl_float)err;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     quantizeGaussianCoeff
+ *  @brief  This function converts float coefficients to integers that sum to
+ *          exactly 1 << shift. The weights are normalized, truncated and the
+ *          remaining units go to the largest remainders, so binomial tables
+ *          such as the 3x3 one are reproduced exactly
+ *
+ *  @param[in] count           : number of coefficients
+ *  @param[in] coeff           : float coefficients
+ *  @param[in] shift           : fixed-point fraction bits
+ *  @param[out] fixedCoeff     : integer coefficients
+ *
+ *  @return cl_float : sum of |fixedCoeff[i] / (1 << shift) - coeff[i]|. A
+ *                     pixel of value v can differ from the float result by at
+ *                     most v times this plus one rounding step
+ *******************************************************************************
+ */
+cl_float quantizeGaussianCoeff(cl_uint count, const cl_float *coeff,
+                cl_uint shift, cl_uint *fixedCoeff)
+{
+    double scale = (double)(1u << shift);
+    double sum = 0.0;
+    cl_uint total = 0;
+
+    for (cl_uint i = 0; i < count; i++)
+        sum += coeff[i];
+
+    for (cl_uint i = 0; i < count; i++)
+    {
+        fixedCoeff[i] = (cl_uint)floor(coeff[i] / sum * scale);
+        total += fixedCoeff[i];
+    }
+
+    /* Hand out the units lost to truncation, largest remainder first */
+    while (total < (1u << shift))
+    {
+        cl_uint best = 0;
+        double bestRem = -1.0;
+        for (cl_uint i = 0; i < count; i++)
+        {
+            double rem = coeff[i] / sum * scale - fixedCoeff[i];
+            if (rem > bestRem)
+            {
+                bestRem = rem;
+                best = i;
+            }
+        }
+        fixedCoeff[best]++;
+        total++;
+    }
+
+    double err = 0.0;
+    for (cl_uint i = 0; i < count; i++)
+        err += fabs(fixedCoeff[i] / scale - coeff[i]);
+
+    return (cl_float)err;
+}
+/**
+ *******************************************************************************
+ *  @fn     parsePointOps
+ *  @brief  This function parses a chain of per-pixel operations of the form
+ *          "op:p0:p1,op:p0,...". The operations are gamma:e, lut:v0:v1:...,
+ *          gain:g:o and clamp:lo:hi, applied in order to pixels normalized
+ *          to [0, 1]
+ *
+ *  @param[in] chain           : operation chain
+ *  @param[out] config         : numPointOps and pointOps
+ *
+ *  @return bool : true if successful; otherwise false.
+ *******************************************************************************
+ */
+bool parsePointOps(const char *chain, filterConfig *config)
+{
+    /* Indexed by POINT_OP_* */
+    static const char *names[] = { "gamma", "lut", "gain", "clamp" };
+    static const cl_uint minParams[] = { 1, 2, 2, 2 };
+    static const cl_uint maxParams[] = { 1, MAX_POINT_OP_PARAMS, 2, 2 };
+
+    config->numPointOps = 0;
+    while (*chain)
+    {
+        if (config->numPointOps == MAX_POINT_OPS)
+            return false;
+
+        pointOp *op = &(config->pointOps[config->numPointOps++]);
+        size_t nameLen = strcspn(chain, ":,");
+        op->type = -1;
+        for (cl_int type = 0; type < (cl_int)(sizeof(names) / sizeof(names[0])); type++)
+        {
+            if (strlen(names[type]) == nameLen && strncmp(chain, names[type], nameLen) == 0)
+                op->type = type;
+        }
+        if (op->type < 0)
+            return false;
+        chain += nameLen;
+
+        op->numParams = 0;
+        while (*chain == ':')
+        {
+            char *end;
+            if (op->numParams == MAX_POINT_OP_PARAMS)
+                return false;
+            op->params[op->numParams] = (cl_float)strtod(chain + 1, &end);
+            /* inf and nan have no OpenCL C literal, nor a float overflow */
+            if (end == chain + 1 || !isfinite(op->params[op->numParams]))
+                return false;
+            op->numParams++;
+            chain = end;
+        }
+        if (op->numParams < minParams[op->type] || op->numParams > maxParams[op->type])
+            return false;
+
+        if (*chain == ',')
+            chain++;
+        else if (*chain)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     generatePointOps
+ *  @brief  This function generates the OpenCL source of the point operation
+ *          chain, a float pointOps(float x) over pixel values that the
+ *          enhance step calls before it saturates. The parameters are written
+ *          as literals, LUTs as __constant tables. The source is compiled
+ *          ahead of the kernel file and defines POINT_OPS
+ *
+ *  @param[in] config          : point operations and bits per pixel
+ *
+ *  @return char * : source to be freed by the caller, NULL if the chain is
+ *                   empty or the allocation failed
+ *******************************************************************************
+ */
+char *generatePointOps(const filterConfig *config)
+{
+    if (config->numPointOps == 0)
+        return NULL;
+
+    size_t size = 512;
+    for (cl_uint k = 0; k < config->numPointOps; k++)
+        size += 256 + config->pointOps[k].numParams * 24;
+
+    char *source = (char *) malloc(size);
+    if (source == NULL)
+        return NULL;
+
+    cl_float maxPixel = (cl_float)((1u << config->bitWidth) - 1);
+    int len = sprintf(source, "#define POINT_OPS 1\n");
+
+    for (cl_uint k = 0; k < config->numPointOps; k++)
+    {
+        const pointOp *op = &(config->pointOps[k]);
+        if (op->type != POINT_OP_LUT)
+            continue;
+        len += sprintf(source + len, "__constant float cPointLut%u[%u] = {", k, op->numParams);
+        for (cl_uint i = 0; i < op->numParams; i++)
+            len += sprintf(source + len, "%s%.9ef", i ? "," : "", op->params[i]);
+        len += sprintf(source + len, "};\n");
+    }
+
+    len += sprintf(source + len, "float pointOps(float x)\n{\n    x *= %.9ef;\n", 1.0f / maxPixel);
+    for (cl_uint k = 0; k < config->numPointOps; k++)
+    {
+        const pointOp *op = &(config->pointOps[k]);
+        switch (op->type)
+        {
+        case POINT_OP_GAMMA:
+            len += sprintf(source + len, "    x = powr(max(x, 0.0f), %.9ef);\n", op->params[0]);
+            break;
+        case POINT_OP_LUT:
+            len += sprintf(source + len, "    {\n        float t = clamp(x, 0.0f, 1.0f) * %u.0f;\n"
+                            "        int i = min((int)t, %u);\n"
+                            "        x = mix(cPointLut%u[i], cPointLut%u[i + 1], t - i);\n    }\n",
+                            op->numParams - 1, op->numParams - 2, k, k);
+            break;
+        case POINT_OP_GAIN:
+            len += sprintf(source + len, "    x = mad(x, %.9ef, %.9ef);\n", op->params[0], op->params[1]);
+            break;
+        case POINT_OP_CLAMP:
+            len += sprintf(source + len, "    x = clamp(x, %.9ef, %.9ef);\n", op->params[0], op->params[1]);
+            break;
+        }
+    }
+    sprintf(source + len, "    return x * %.9ef;\n}\n", maxPixel);
+
+    return source;
+}
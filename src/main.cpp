@@ -46,6 +46,20 @@ using namespace appsdk;
 #define DEFAULT_OPENCL_OUTPUT_IMAGE     "gaussianOutput.bmp"
 #define DEFAULT_ENH_OUTPUT_IMAGE        "enhancedOutput.bmp"
 #define DEFAULT_BITWIDTH                8
+#define DEFAULT_TUNE_FILE               "gaussianFilter.tune"
+#define PYRAMID_OUTPUT_IMAGE            "gaussianPyramid_L%d.bmp"
+#define BOX_MEAN_OUTPUT_IMAGE           "boxMeanOutput.bmp"
+#define BATCH_GAUSSIAN_OUTPUT_IMAGE     "gaussianOutput_%d.bmp"
+#define BATCH_ENHANCED_OUTPUT_IMAGE     "enhancedOutput_%d.bmp"
+#define DEFAULT_DETAIL_GAIN             2.0f
+
+/******************************************************************************
+ * Work-group tiles tried by -autotune                                         *
+ ******************************************************************************/
+static const cl_uint autotuneTiles[][2] = {
+    { 16, 16 }, { 32, 8 }, { 64, 4 }, { 8, 32 }, { 16, 8 },
+    { 32, 4 }, { 8, 8 }, { 32, 16 }, { 64, 2 }, { 128, 2 } };
+#define AUTOTUNE_ITERATIONS             5
 
 /******************************************************************************
  * Structure to hold the parameters for the sample                             *
@@ -60,19 +74,27 @@ typedef struct filters
 
     cl_uint filterSize;
     cl_float *gaussianFilterCpu;
+    cl_float *gaussianFilter1DCpu;
+    cl_uint *gaussianFilterFixedCpu;
+    cl_float fixedPointError;
+    cl_float halfPrecisionError;
+    cl_uint pixelBytes;         // Bytes per stored pixel, all channels
+    pyramidLayout pyramid;
+    cl_uchar *pyramidImg;       // Pyramid levels below the input, see pyramidLayout
+    const char *radiusMapImage; // Per-pixel radius of the box mean, r channel
+    cl_uchar *radiusMapImg;
+    cl_uchar *boxMeanImg;
+    const char *batchImages;    // Comma-separated inputs of frames 1 and up, NULL - input repeated
 
     cl_uchar *inputImg;
+    cl_uchar *packedImg;        // Padded rows of inputImg as a 10 or 12 bit stream, NULL - not packed
+    size_t packedPitch;         // Bytes per packed row
     cl_uchar *gaussianOutputImg;
     cl_uchar *enhancedOutputImg;
 
-    cl_mem input;
-    cl_mem gaussianFilter;
-    cl_mem gaussianOutput;
-    cl_mem enhancedOutput;    
-
-    cl_kernel gaussianKernel;
-    cl_kernel enhancedKernel;
-    cl_kernel combinedKernel;
+    filterConfig config;
+    filterBuffers mem;
+    filterKernels kernels;
 
     SDKBitMap inputBitmap;   /**< Bitmap class object */
 
@@ -93,10 +115,16 @@ bool createMemory(filters* paramFF, DeviceInfo *infoDeviceOcl,
 void destroyMemory(filters *paramFF, DeviceInfo *infoDeviceOcl);
 bool saveOutputs(filters *paramFF, const char *filename1, const char *filename2,
                 cl_uint bitWidth);
-bool run(DeviceInfo *infoDeviceOcl, filters *paramFF, cl_uint bitWidth, cl_uint runCombinedKernel, cl_uint dataTransfer);
+bool run(DeviceInfo *infoDeviceOcl, filters *paramFF, cl_uint dataTransfer);
+void verifyOutput(filters *paramFF, cl_uint bitWidth);
+bool tileSupported(DeviceInfo *infoDeviceOcl, filterConfig *config,
+                cl_uint localXRes, cl_uint localYRes);
+bool loadTunedLocalSize(DeviceInfo *infoDeviceOcl, filters *paramFF);
+void storeTunedLocalSize(DeviceInfo *infoDeviceOcl, filters *paramFF);
+bool autotuneLocalSize(DeviceInfo *infoDeviceOcl, filters *paramFF);
 bool init(DeviceInfo *infoDeviceOcl, filters *paramFF,
-                const char *inputImage, cl_int filterSize,
-                cl_uint bitWidth, cl_uint deviceNum, cl_int useLds, cl_int zeroCopy, cl_int useIntrinsics);
+                const char *inputImage, filterConfig *config,
+                cl_uint deviceNum, cl_int zeroCopy, cl_int autotune);
 
 /**
  *******************************************************************************
@@ -111,8 +139,41 @@ bool init(DeviceInfo *infoDeviceOcl, filters *paramFF,
 void usage(const char *prog)
 {
     printf("Usage: %s \n\t[-i (input image path)]", prog);
-    printf("\n\t[-combinedKernel (0 | 1)] \n\t[-zeroCopy (0 | 1)] //0 (default) - Device buffer, 1 - zero copy buffer\n\t[-filtSize (filterSize 3 | 5)]\n\t[-useLds (0 | 1)]");                    
-    printf("\n\t[-reduceOverhead (0 | 1)]\n\t[-useIntrinsics (0 | 1)]\n\t[-h (help)]\n\n");                    
+    printf("\n\t[-combinedKernel (0 | 1)] \n\t[-zeroCopy (0 | 1)] //0 (default) - Device buffer, 1 - zero copy buffer\n\t[-filtSize (odd filterSize 3 - %d)]\n\t[-bitWidth (8 | 10 | 12 | 16)] //10 and 12 - Input packed as a bitstream, unpacked by the kernels\n\t[-useLds (0 | 1 | 2)] //2 - Sub-group shuffles, LDS tile if unsupported", MAX_FILTER_SIZE);                    
+    printf("\n\t[-reduceOverhead (0 | 1)]\n\t[-useIntrinsics (0 | 1)]");
+    printf("\n\t[-filterMode (0 | 1 | 2 | 3)] //0 (default) - Non-separable 2D convolution, 1 - Separable horizontal + vertical passes");
+    printf("\n\t                       //2 - Recursive (IIR) Gaussian for -sigma, cost independent of sigma");
+    printf("\n\t                       //3 - Three box blurs approximating -sigma (or -radius / 3), cost independent of sigma");
+    printf("\n\t[-rowsPerItem (1 | 2 | 4 | 8)] //Output rows computed by each work-item of the non-separable kernels");
+    printf("\n\t[-vecWidth (1 | 2 | 4 | 8 | 16)] //Pixels loaded/stored as one vector per work-item, 1 (default) - scalar");
+    printf("\n\t[-sigma (sigma)] //Generate Gaussian coefficients for this sigma");
+    printf("\n\t[-radius (radius)] //Filter radius, overrides -filtSize with 2 * radius + 1");
+    printf("\n\t[-bakeCoeff (0 | 1)] //1 - Compile the coefficients into the kernels as constants");
+    printf("\n\t[-fixedPoint (0 | 1)] //1 - 8 bit only, integer coefficients and accumulation");
+    printf("\n\t[-halfPrecision (0 | 1)] //1 - 8 bit only, half coefficients and accumulation (cl_khr_fp16)");
+    printf("\n\t[-channels (1 | 3 | 4)] //1 (default) - r channel only, 3 - RGB, 4 - RGBA");
+    printf("\n\t[-planar (0 | 1)] //0 (default) - Interleaved uchar4/ushort4 pixels, 1 - One plane per channel, one launch");
+    printf("\n\t[-pyramidLevels (0 - %d)] //Also build this many blurred and 2x decimated levels, 0 (default) - none", MAX_PYRAMID_LEVELS);
+    printf("\n\t[-multiScale (0 | 1)] //1 - Enhanced output from the Laplacian pyramid of the pyramid levels, needs -pyramidLevels");
+    printf("\n\t[-detailGain (g0,g1,...)] //Gain of each Laplacian level, finest first, the last one repeats. Default: %.1f", DEFAULT_DETAIL_GAIN);
+    printf("\n\t[-pointOps (op:p0:p1,...)] //Per-pixel chain on the enhanced output, pixels in [0, 1]:");
+    printf("\n\t                           //gamma:e, lut:v0:v1:..., gain:g:o, clamp:lo:hi. Default: none");
+    printf("\n\t[-persistent (0 | 1)] //1 - Combined kernel as one work-group per compute unit pulling tiles from a counter");
+    printf("\n\t[-frames (frames)] //Frames filtered per launch, the input repeated. Default: 1");
+    printf("\n\t                   //Without -persistent 1 the direct kernels take them as a 3D NDRange");
+    printf("\n\t[-batch (image,image,...)] //Same-sized images filtered with the input in one 3D launch, sets -frames");
+    printf("\n\t[-satRadius (radius)] //Also compute the box mean of this radius from a summed-area table, 0 (default) - none");
+    printf("\n\t[-radiusMap (image path)] //Per-pixel box-mean radius, r channel 255 maps to satRadius, 0 to radius 0, same size as the input");
+    printf("\n\t[-useImage (0 | 1)] //1 - Upload the unpadded input as an image and read it through a sampler");
+    printf("\n\t[-borderMode (0 | 1 | 2 | 3)] //Border handled on the device: 0 - Zero, 1 - Replicate, 2 - Reflect, 3 - Wrap");
+    printf("\n\t                              //Not given (default) - Host pads the input with zeros");
+    printf("\n\t[-localSize (WxH)] //Work-group tile of the 2D kernels, e.g. 32x8. Default: tuned value or %dx%d", LOCAL_XRES, LOCAL_YRES);
+    printf("\n\t[-autotune (0 | 1)] //1 - Time the candidate tiles, use the fastest and store it in %s", DEFAULT_TUNE_FILE);
+    printf("\n\t[-foldCoeff (0 | 1)] //1 (default) - Add mirrored pixels before multiplying when the coefficients are symmetric");
+    printf("\n\t[-roi (x,y,w,h)] //Filter only this rectangle, only it and its halo are transferred. Default: whole image");
+    printf("\n\t[-output (0 | 1 | 2)] //0 (default) - Gaussian and enhanced, 1 - Gaussian only, 2 - Enhanced only");
+    printf("\n\t[-verify (0 | 1)] //1 (default) - Compare the Gaussian output with a CPU float reference, skipped with -output 2");
+    printf("\n\t[-h (help)]\n\n");                    
     printf("Example: To run 5X5 filter on 8 bit/channel input image, run");
     printf("\n\t %s -i Nature_2048x1024.bmp -filtSize 5 -useLds 0 -zeroCopy 0 -reduceOverhead 1\n", prog);    
 }
@@ -131,9 +192,38 @@ int main(int argc, char **argv)
     cl_uint zeroCopy = 0;
     cl_uint optimizedPipeline = 1;
     cl_uint verify = 1;
+    cl_uint outputSelect = OUTPUT_BOTH;
+    roiRect roi = { 0, 0, 0, 0 };
     cl_uint useIntrinsics = 1;
     cl_uint runCombinedKernel = 0;
     cl_uint dataTransfer = 1;
+    cl_int filterMode = FILTER_MODE_DIRECT;
+    cl_uint rowsPerItem = 1;
+    cl_uint vecWidth = 1;
+    cl_float sigma = 0.0f;
+    cl_int radius = 0;
+    cl_int bakeCoeff = 0;
+    cl_int fixedPoint = 0;
+    cl_int halfPrecision = 0;
+    cl_uint channels = 1;
+    cl_int planar = 0;
+    cl_uint pyramidLevels = 0;
+    cl_int multiScale = 0;
+    cl_float detailGain[MAX_PYRAMID_LEVELS];
+    cl_uint detailGains = 0;
+    const char *pointOpChain = NULL;
+    cl_int persistent = 0;
+    cl_uint frames = 1;
+    const char *batchImages = NULL;
+    cl_uint satRadius = 0;
+    const char *radiusMapImage = NULL;
+    cl_int useImage = 0;
+    cl_int borderMode = BORDER_MODE_HOST_PAD;
+    cl_uint localXRes = 0;
+    cl_uint localYRes = 0;
+    cl_int autotune = 0;
+    cl_int foldCoeff = 1;
+    bool filterSizeSet = false;
     
     const char *inputImage = DEFAULT_INPUT_IMAGE;
     const char *gaussianOutputImage = DEFAULT_OPENCL_OUTPUT_IMAGE;
@@ -161,9 +251,10 @@ int main(int argc, char **argv)
             tmpArgv++;
             tmpArgc--;
             filterSize = atoi(tmpArgv[1]);
-            if (!(filterSize == 3 || filterSize == 5 || filterSize == 7 || filterSize == 9))
+            filterSizeSet = true;
+            if (filterSize < 3 || filterSize > MAX_FILTER_SIZE || !(filterSize & 1))
             {
-                printf("Only filter sizes 3, 5, 7 and 9 are supported.\n");
+                printf("Only odd filter sizes from 3 to %d are supported.\n", MAX_FILTER_SIZE);
                 exit(1);
             }
         }
@@ -172,9 +263,9 @@ int main(int argc, char **argv)
             tmpArgv++;
             tmpArgc--;
             bitWidth = atoi(tmpArgv[1]);
-            if (!(bitWidth == 8 || bitWidth == 16))
+            if (!(bitWidth == 8 || bitWidth == 10 || bitWidth == 12 || bitWidth == 16))
             {
-                printf("Only 8 and 16 are supported bitWidth.\n");
+                printf("Only 8, 10, 12 and 16 are supported bitWidth.\n");
                 exit(1);
             }
         }
@@ -183,6 +274,11 @@ int main(int argc, char **argv)
             tmpArgv++;
             tmpArgc--;
             useLds = atoi(tmpArgv[1]);
+            if (useLds < 0 || useLds > LDS_MODE_SHUFFLE)
+            {
+                printf("Only 0, 1 and 2 are supported useLds values.\n");
+                exit(1);
+            }
         }
         else if (strncmp(tmpArgv[1], "-device", 7) == 0)
         {
@@ -196,6 +292,28 @@ int main(int argc, char **argv)
             tmpArgc--;
             verify = atoi(tmpArgv[1]);
         }
+        else if (strncmp(tmpArgv[1], "-output", 7) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            outputSelect = atoi(tmpArgv[1]);
+            if (outputSelect > OUTPUT_ENHANCED)
+            {
+                printf("Invalid -output %d, use 0 (both), 1 (Gaussian) or 2 (enhanced).\n", outputSelect);
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-roi", 4) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            if (sscanf(tmpArgv[1], "%u,%u,%u,%u", &roi.x, &roi.y, &roi.width, &roi.height) != 4 ||
+                roi.width == 0 || roi.height == 0)
+            {
+                printf("-roi expects x,y,w,h, e.g. 256,128,320,240.\n");
+                exit(1);
+            }
+        }
         else if (strncmp(tmpArgv[1], "-zeroCopy", 9) == 0)
         {
             tmpArgv++;
@@ -220,6 +338,218 @@ int main(int argc, char **argv)
             tmpArgc--;
             runCombinedKernel = atoi(tmpArgv[1]);
         }
+        else if (strncmp(tmpArgv[1], "-filterMode", 11) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            filterMode = atoi(tmpArgv[1]);
+            if (!(filterMode == FILTER_MODE_DIRECT || filterMode == FILTER_MODE_SEPARABLE ||
+                  filterMode == FILTER_MODE_RECURSIVE || filterMode == FILTER_MODE_BOX))
+            {
+                printf("Only filter modes 0 (non-separable), 1 (separable), 2 (recursive) and 3 (box) are supported.\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-rowsPerItem", 12) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            rowsPerItem = atoi(tmpArgv[1]);
+            if (!(rowsPerItem == 1 || rowsPerItem == 2 || rowsPerItem == 4 || rowsPerItem == 8))
+            {
+                printf("Only 1, 2, 4 and 8 rows per work-item are supported.\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-vecWidth", 9) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            vecWidth = atoi(tmpArgv[1]);
+            if (!(vecWidth == 1 || vecWidth == 2 || vecWidth == 4 || vecWidth == 8 || vecWidth == 16))
+            {
+                printf("Only vector widths 1, 2, 4, 8 and 16 are supported.\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-sigma", 6) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            sigma = (cl_float)atof(tmpArgv[1]);
+            if (sigma <= 0.0f)
+            {
+                printf("sigma must be positive.\n");
+                exit(1);
+            }
+        }
+        /* Before -radius, which is a prefix of it */
+        else if (strncmp(tmpArgv[1], "-radiusMap", 10) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            radiusMapImage = tmpArgv[1];
+        }
+        else if (strncmp(tmpArgv[1], "-radius", 7) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            radius = atoi(tmpArgv[1]);
+            if (radius < 1)
+            {
+                printf("radius must be at least 1.\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-bakeCoeff", 10) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            bakeCoeff = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-fixedPoint", 11) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            fixedPoint = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-halfPrecision", 14) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            halfPrecision = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-channels", 9) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            channels = atoi(tmpArgv[1]);
+            if (!(channels == 1 || channels == 3 || channels == 4))
+            {
+                printf("Only 1, 3 and 4 channels are supported.\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-planar", 7) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            planar = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-pyramidLevels", 14) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            pyramidLevels = atoi(tmpArgv[1]);
+            if (pyramidLevels > MAX_PYRAMID_LEVELS)
+            {
+                printf("At most %d pyramid levels are supported.\n", MAX_PYRAMID_LEVELS);
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-multiScale", 11) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            multiScale = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-detailGain", 11) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            char *gain = tmpArgv[1];
+            for (detailGains = 0; detailGains < MAX_PYRAMID_LEVELS; )
+            {
+                char *end;
+                detailGain[detailGains] = (cl_float)strtod(gain, &end);
+                if (end == gain)
+                    break;
+                detailGains++;
+                if (*end != ',')
+                    break;
+                gain = end + 1;
+            }
+            if (detailGains == 0)
+            {
+                printf("-detailGain expects a comma separated list of gains, e.g. 2.0,1.5.\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-pointOps", 9) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            pointOpChain = tmpArgv[1];
+        }
+        else if (strncmp(tmpArgv[1], "-persistent", 11) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            persistent = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-frames", 7) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            frames = atoi(tmpArgv[1]);
+            if (frames < 1)
+            {
+                printf("-frames must be at least 1.\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-batch", 6) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            batchImages = tmpArgv[1];
+        }
+        else if (strncmp(tmpArgv[1], "-satRadius", 10) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            satRadius = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-useImage", 9) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            useImage = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-localSize", 10) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            if (sscanf(tmpArgv[1], "%ux%u", &localXRes, &localYRes) != 2 ||
+                localXRes == 0 || localYRes == 0)
+            {
+                printf("-localSize expects WxH, e.g. 32x8.\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(tmpArgv[1], "-autotune", 9) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            autotune = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-foldCoeff", 10) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            foldCoeff = atoi(tmpArgv[1]);
+        }
+        else if (strncmp(tmpArgv[1], "-borderMode", 11) == 0)
+        {
+            tmpArgv++;
+            tmpArgc--;
+            borderMode = atoi(tmpArgv[1]);
+            if (borderMode < BORDER_MODE_CONSTANT || borderMode > BORDER_MODE_WRAP)
+            {
+                printf("Only border modes 0 (zero), 1 (replicate), 2 (reflect) and 3 (wrap) are supported.\n");
+                exit(1);
+            }
+        }
         else if (strncmp(tmpArgv[1], "-h", 2) == 0)
         {
             usage(argv[0]);
@@ -245,111 +575,411 @@ int main(int argc, char **argv)
     {
         dataTransfer = 0;
     }
-    
-    /***************************************************************************
-     * Read input, initialize OpenCL runtime, create memory and OpenCL kernels
-     **************************************************************************/
-    if (init(&infoDeviceOcl, &paramFF, inputImage, filterSize,
-                    bitWidth, deviceNum, useLds, zeroCopy, useIntrinsics) != true)
+
+    /* An explicit radius wins, otherwise a sigma alone picks a 3-sigma radius.
+       The recursive filter has no radius, any sigma is accepted. The box
+       approximation takes its radii as kernel arguments, a radius only sets
+       its sigma */
+    if (filterMode != FILTER_MODE_BOX && 2 * radius + 1 > MAX_FILTER_SIZE)
     {
-        printf("Error in init.\n");
-        return -1;
+        printf("Only radius 1 to %d is supported, any radius with -filterMode 3.\n", MAX_FILTER_SIZE / 2);
+        exit(1);
     }
 
-
-    
-    /***************************************************************************
-    * Print information about input and other improtant details              
-    **************************************************************************/
-    if (!runCombinedKernel)
-        printf("Executing Gaussian filter and Enhance kernel one after other.");
-    else
-        printf("Executing one combined filter containing Gaussian and Enhance filters.");
-    printf("\n\tFilter size: %dx%d\n\tInput Image: %d bit single channel\n\tInput Image resolution: %dx%d", 
-                    filterSize, filterSize, bitWidth, paramFF.cols, paramFF.rows);
-     
-    if (zeroCopy)
-        printf("\n\tKernels are using zero copy buffers.");
-    else 
-        printf("\n\tKernels are using device buffers.");
-
-    if (useLds)
-        printf("\n\tKernels are using Lds memory for input.");
-    else 
-        printf("\n\tKernels are not using Lds memory for input.");
-
-    printf("\n\nRunning for %d iterations\n\n", loopCnt);
-
-    /***************************************************************************
-    * Warm-up run of OpenCL Gaussian filters                            
-    **************************************************************************/
-    if (run(&infoDeviceOcl, &paramFF, bitWidth, runCombinedKernel, dataTransfer) != true)
+    if (filterMode == FILTER_MODE_BOX)
     {
-        printf("Error in run.\n");
-        return -1;
+        if (sigma <= 0.0f && radius > 0)
+            sigma = radius / 3.0f;
+        if (sigma <= 0.0f)
+            sigma = 0.3f * ((filterSize - 1) * 0.5f - 1.0f) + 0.8f;
+        if (runCombinedKernel)
+        {
+            printf("-filterMode 3 has no combined kernel, running the box passes and the enhance kernel.\n");
+            runCombinedKernel = 0;
+        }
     }
-    clFinish(infoDeviceOcl.mQueue);
-
-    /*******************************************************************************
-    * Get Performance data
-    *******************************************************************************/
-    timer t_timer;
-    timerStart(&t_timer);
-
-    for (int i = 0; i < loopCnt; i++)
+    else if (filterMode == FILTER_MODE_RECURSIVE)
     {
-        if (run(&infoDeviceOcl, &paramFF, bitWidth, runCombinedKernel, dataTransfer) != true)
+        if (sigma <= 0.0f)
+            sigma = 0.3f * ((filterSize - 1) * 0.5f - 1.0f) + 0.8f;
+        if (sigma < RECURSIVE_MIN_SIGMA)
         {
-            printf("Error in run.\n");
-            return -1;
+            printf("-filterMode 2 needs a sigma of at least %.1f.\n", RECURSIVE_MIN_SIGMA);
+            exit(1);
         }
-
-        if (!optimizedPipeline)
+        if (runCombinedKernel)
         {
-            clFinish(infoDeviceOcl.mQueue);
+            printf("-filterMode 2 has no combined kernel, running the recursive filter and the enhance kernel.\n");
+            runCombinedKernel = 0;
         }
     }
-    clFinish(infoDeviceOcl.mQueue);
+    else if (radius > 0)
+    {
+        filterSize = 2 * radius + 1;
+    }
+    else if (sigma > 0.0f && !filterSizeSet)
+    {
+        filterSize = 2 * (cl_int)ceil(3.0f * sigma) + 1;
+        if (filterSize > MAX_FILTER_SIZE)
+            filterSize = MAX_FILTER_SIZE;
+    }
 
-    double time_ms = timerCurrent(&t_timer);
-    time_ms = 1000 * (time_ms / loopCnt);
+    if (rowsPerItem > 1 && (filterMode != FILTER_MODE_DIRECT || useLds))
+    {
+        printf("-rowsPerItem is only supported with -filterMode 0 and -useLds 0.\n");
+        exit(1);
+    }
 
-    if (zeroCopy)
-        printf("Average time taken per iteration using zero-copy buffer: %f msec\n", time_ms);
-    else
-        printf("Average time taken per iteration using device-memory with data-transfer: %f msec\n", time_ms);
-    
-    /*******************************************************************************
-    * Get Performance data without data transfer in case of using device-memory
-    *******************************************************************************/
-    if (!zeroCopy)
+    if (vecWidth > 1 && (filterMode != FILTER_MODE_DIRECT || useLds || rowsPerItem > 1))
     {
-        
-        timerStart(&t_timer);
+        printf("-vecWidth is only supported with -filterMode 0, -useLds 0 and -rowsPerItem 1.\n");
+        exit(1);
+    }
 
-        for (int i = 0; i < loopCnt; i++)
-        {
-            if (run(&infoDeviceOcl, &paramFF, bitWidth, runCombinedKernel, 0) != true)
-            {
-                printf("Error in run.\n");
-                return -1;
-            }
+    if (useLds == LDS_MODE_SHUFFLE && filterMode != FILTER_MODE_DIRECT)
+    {
+        printf("-useLds 2 is only supported with -filterMode 0.\n");
+        exit(1);
+    }
 
-            if (!optimizedPipeline)
-            {
-                clFinish(infoDeviceOcl.mQueue);
-            }
-        }
-        clFinish(infoDeviceOcl.mQueue);
+    if (fixedPoint && (bitWidth != 8 || filterMode != FILTER_MODE_DIRECT || rowsPerItem > 1 || vecWidth > 1 ||
+                       useLds == LDS_MODE_SHUFFLE))
+    {
+        printf("-fixedPoint is only supported with -bitWidth 8, -filterMode 0, -rowsPerItem 1, -vecWidth 1 and -useLds 0 or 1.\n");
+        exit(1);
+    }
 
-        double time_ms = timerCurrent(&t_timer);
-        time_ms = 1000 * (time_ms / loopCnt);
+    if (halfPrecision && (bitWidth != 8 || filterMode != FILTER_MODE_DIRECT || useLds || rowsPerItem > 1 || fixedPoint))
+    {
+        printf("-halfPrecision is only supported with -bitWidth 8, -filterMode 0, -useLds 0, -rowsPerItem 1 and -fixedPoint 0.\n");
+        exit(1);
+    }
 
-        printf("Average time taken per iteration using device-memory without any data-transfer: %f msec\n", time_ms);
+    if (channels > 1 && (filterMode != FILTER_MODE_DIRECT || useLds || rowsPerItem > 1 || vecWidth > 1 ||
+                         fixedPoint || halfPrecision || useImage || borderMode != BORDER_MODE_HOST_PAD))
+    {
+        printf("-channels 3 and 4 are only supported with -filterMode 0, -useLds 0, -rowsPerItem 1, -vecWidth 1, -fixedPoint 0, -halfPrecision 0, -useImage 0 and no -borderMode.\n");
+        exit(1);
     }
 
+    if (pyramidLevels && (channels > 1 || fixedPoint || useImage))
+    {
+        printf("-pyramidLevels is only supported with -channels 1, -fixedPoint 0 and -useImage 0.\n");
+        exit(1);
+    }
 
-    /***************************************************************************
+    if (pointOpChain && (vecWidth > 1 || (channels > 1 && !planar)))
+    {
+        printf("-pointOps is only supported with -vecWidth 1, and with -planar 1 for -channels 3 and 4.\n");
+        exit(1);
+    }
+
+    if (persistent && (filterMode != FILTER_MODE_DIRECT || !runCombinedKernel || useLds || rowsPerItem > 1 ||
+                       vecWidth > 1 || fixedPoint || halfPrecision || channels > 1 || useImage ||
+                       borderMode != BORDER_MODE_HOST_PAD || pyramidLevels))
+    {
+        printf("-persistent is only supported with -filterMode 0, -combinedKernel 1, -useLds 0, -rowsPerItem 1, -vecWidth 1, -fixedPoint 0, -halfPrecision 0, -channels 1, -useImage 0, -pyramidLevels 0 and no -borderMode.\n");
+        exit(1);
+    }
+
+    /* The batch follows the input, one frame per listed image */
+    if (batchImages)
+    {
+        frames = 2;
+        for (const char *c = batchImages; *c; c++)
+            frames += (*c == ',');
+    }
+
+    if (frames > 1 && !persistent &&
+        (filterMode != FILTER_MODE_DIRECT || useLds == LDS_MODE_SHUFFLE || rowsPerItem > 1 || vecWidth > 1 ||
+         fixedPoint || halfPrecision || channels > 1 || useImage || borderMode != BORDER_MODE_HOST_PAD ||
+         pyramidLevels || roi.width))
+    {
+        printf("Batched -frames and -batch are only supported with -filterMode 0, -useLds 0 or 1, -rowsPerItem 1, -vecWidth 1, -fixedPoint 0, -halfPrecision 0, -channels 1, -useImage 0, -pyramidLevels 0, no -borderMode and no -roi.\n");
+        exit(1);
+    }
+
+    if (satRadius && (channels > 1 || useImage || frames > 1))
+    {
+        printf("-satRadius is only supported with -channels 1, -useImage 0 and -frames 1.\n");
+        exit(1);
+    }
+
+    if (radiusMapImage && !satRadius)
+    {
+        printf("-radiusMap needs -satRadius 1 or more.\n");
+        exit(1);
+    }
+
+    if (roi.width && (filterMode != FILTER_MODE_DIRECT || rowsPerItem > 1 || vecWidth > 1 || channels > 1 ||
+                    useImage || persistent || pyramidLevels || satRadius || borderMode == BORDER_MODE_WRAP))
+    {
+        printf("-roi is only supported with -filterMode 0, -rowsPerItem 1, -vecWidth 1, -channels 1, -useImage 0, -persistent 0, -pyramidLevels 0, -satRadius 0 and -borderMode other than 3.\n");
+        exit(1);
+    }
+
+    if (outputSelect == OUTPUT_GAUSSIAN && (multiScale || pointOpChain))
+    {
+        printf("-multiScale and -pointOps change the enhanced output, they need -output 0 or 2.\n");
+        exit(1);
+    }
+
+    /* The CPU reference is compared with the Gaussian output, which is not read back */
+    if (outputSelect == OUTPUT_ENHANCED)
+        verify = 0;
+
+    if (multiScale && pyramidLevels == 0)
+    {
+        printf("-multiScale needs -pyramidLevels 1 or more.\n");
+        exit(1);
+    }
+
+    if (useImage && (filterMode != FILTER_MODE_DIRECT || useLds || rowsPerItem > 1 || vecWidth > 1 || fixedPoint || halfPrecision))
+    {
+        printf("-useImage is only supported with -filterMode 0, -useLds 0, -rowsPerItem 1, -vecWidth 1, -fixedPoint 0 and -halfPrecision 0.\n");
+        exit(1);
+    }
+
+    if (borderMode != BORDER_MODE_HOST_PAD && !useImage &&
+        (filterMode != FILTER_MODE_DIRECT || useLds || rowsPerItem > 1 || vecWidth > 1 || fixedPoint || halfPrecision))
+    {
+        printf("-borderMode is only supported with -filterMode 0, -useLds 0, -rowsPerItem 1, -vecWidth 1, -fixedPoint 0 and -halfPrecision 0.\n");
+        exit(1);
+    }
+
+    if (packedBits(bitWidth) && (filterMode != FILTER_MODE_DIRECT || useLds || rowsPerItem > 1 || vecWidth > 1 ||
+                                 fixedPoint || halfPrecision || channels > 1 || useImage ||
+                                 borderMode != BORDER_MODE_HOST_PAD || persistent || frames > 1 ||
+                                 pyramidLevels || satRadius || roi.width))
+    {
+        printf("-bitWidth 10 and 12 are only supported with -filterMode 0, -useLds 0, -rowsPerItem 1, -vecWidth 1, -fixedPoint 0, -halfPrecision 0, -channels 1, -useImage 0, -persistent 0, -frames 1, -pyramidLevels 0, -satRadius 0, no -borderMode and no -roi.\n");
+        exit(1);
+    }
+
+    filterConfig config;
+    config.filtSize = filterSize;
+    config.bitWidth = bitWidth;
+    config.useLds = useLds;
+    config.useIntrinsics = useIntrinsics;
+    config.filterMode = filterMode;
+    config.runCombinedKernel = runCombinedKernel;
+    config.rowsPerItem = rowsPerItem;
+    config.vecWidth = vecWidth;
+    config.sigma = sigma;
+    computeBoxRadii(sigma, config.boxRadius);
+    config.bakeCoeff = bakeCoeff;
+    config.fixedPoint = fixedPoint;
+    config.useImage = useImage;
+    config.borderMode = borderMode;
+    config.localXRes = localXRes;
+    config.localYRes = localYRes;
+    config.foldCoeff = foldCoeff;
+    config.halfPrecision = halfPrecision;
+    config.channels = channels;
+    config.planar = (channels > 1) ? planar : 0;
+    config.pyramidLevels = pyramidLevels;
+    config.multiScale = multiScale;
+    config.strip = 0;
+    config.persistent = persistent;
+    config.persistentGroups = 0;
+    config.frames = frames;
+    config.batched = (frames > 1 && !persistent);
+    paramFF.batchImages = batchImages;
+    config.satRadius = satRadius;
+    config.outputSelect = outputSelect;
+    config.roi = roi;
+    config.radiusMap = (radiusMapImage != NULL);
+    paramFF.radiusMapImage = radiusMapImage;
+    config.numPointOps = 0;
+    if (pointOpChain && !parsePointOps(pointOpChain, &config))
+    {
+        printf("Invalid -pointOps chain %s, at most %d operations of gamma:e, lut:v0:v1:..., gain:g:o and clamp:lo:hi.\n",
+                        pointOpChain, MAX_POINT_OPS);
+        exit(1);
+    }
+    for (cl_uint level = 0; level < MAX_PYRAMID_LEVELS; level++)
+    {
+        if (detailGains == 0)
+            config.detailGain[level] = DEFAULT_DETAIL_GAIN;
+        else
+            config.detailGain[level] = detailGain[level < detailGains ? level : detailGains - 1];
+    }
+    
+    /***************************************************************************
+     * Read input, initialize OpenCL runtime, create memory and OpenCL kernels
+     **************************************************************************/
+    if (init(&infoDeviceOcl, &paramFF, inputImage, &config,
+                    deviceNum, zeroCopy, autotune) != true)
+    {
+        printf("Error in init.\n");
+        return -1;
+    }
+
+
+    
+    /***************************************************************************
+    * Print information about input and other improtant details              
+    **************************************************************************/
+    if (!runCombinedKernel)
+        printf("Executing Gaussian filter and Enhance kernel one after other.");
+    else
+        printf("Executing one combined filter containing Gaussian and Enhance filters.");
+    if (filterMode == FILTER_MODE_SEPARABLE)
+        printf("\n\tGaussian filter runs as separable horizontal and vertical passes.");
+    if (filterMode == FILTER_MODE_RECURSIVE)
+        printf("\n\tGaussian filter runs as recursive causal and anti-causal passes over rows and columns.");
+    if (filterMode == FILTER_MODE_BOX)
+        printf("\n\tGaussian filter runs as box blurs of radius %d, %d and %d over rows and columns, error bound %.3f.",
+                        config.boxRadius[0], config.boxRadius[1], config.boxRadius[2],
+                        ((1 << bitWidth) - 1) * boxGaussianError(sigma, config.boxRadius) + 1.0f);
+    if (rowsPerItem > 1)
+        printf("\n\tEach work-item computes %d output rows.", rowsPerItem);
+    if (vecWidth > 1)
+        printf("\n\tEach work-item loads and stores %d pixels as one vector.", vecWidth);
+    if (packedBits(bitWidth))
+        printf("\n\tInput is uploaded packed, %d bytes per row instead of %d, and unpacked by the kernels.",
+                        (int)paramFF.packedPitch, paramFF.paddedCols * 2);
+    if (channels == 1)
+        printf("\n\tFilter size: %dx%d\n\tInput Image: %d bit single channel\n\tInput Image resolution: %dx%d", 
+                        filterSize, filterSize, bitWidth, paramFF.cols, paramFF.rows);
+    else
+        printf("\n\tFilter size: %dx%d\n\tInput Image: %d bit %d channels, %s\n\tInput Image resolution: %dx%d",
+                        filterSize, filterSize, bitWidth, channels,
+                        planar ? "planar, all planes in one launch" : "interleaved 4-channel vectors",
+                        paramFF.cols, paramFF.rows);
+    printf("\n\tWork-group tile: %dx%d", paramFF.config.localXRes, paramFF.config.localYRes);
+    if (sigma > 0.0f)
+        printf("\n\tCoefficients generated for sigma %f.", sigma);
+    if (bakeCoeff)
+        printf("\n\tCoefficients are compiled into the kernels as constants.");
+    if (paramFF.config.foldCoeff)
+        printf("\n\tCoefficients are symmetric, mirrored taps are folded.");
+    if (fixedPoint)
+        printf("\n\tGaussian filter uses %d bit fixed-point coefficients, error bound %.3f.",
+                        FIXED_POINT_SHIFT, 255.0f * paramFF.fixedPointError + 1.0f);
+    if (paramFF.config.halfPrecision)
+        printf("\n\tGaussian filter uses half-precision coefficients and accumulation, error bound %.3f.",
+                        paramFF.halfPrecisionError + 1.0f);
+     
+    if (pyramidLevels)
+        printf("\n\tGaussian pyramid of %d levels, levels up to %dx%d are built in LDS by one work-group.",
+                        pyramidLevels, PYRAMID_LDS_DIM, PYRAMID_LDS_DIM);
+    if (paramFF.config.strip)
+        printf("\n\tCPU device, each work-item filters a %dx%d strip through a ring of %d rows.",
+                        STRIP_WIDTH, STRIP_ROWS, filterSize);
+    if (persistent)
+        printf("\n\tCombined kernel runs as %d persistent work-groups over %d frame(s) per launch.",
+                        paramFF.config.persistentGroups, frames);
+    if (paramFF.config.batched)
+        printf("\n\t%d frames are filtered by one 3D launch%s.", frames,
+                        batchImages ? "" : ", the input repeated");
+    if (satRadius)
+        printf("\n\tBox mean of %s %d from a %s summed-area table.",
+                        radiusMapImage ? "per-pixel radius up to" : "radius", satRadius,
+                        satIsWide(&config) ? "ulong" : "uint");
+    if (roi.width)
+        printf("\n\tOnly the %dx%d region at (%d, %d) is filtered and transferred.",
+                        roi.width, roi.height, roi.x, roi.y);
+    if (outputSelect != OUTPUT_BOTH)
+        printf("\n\tOnly the %s output is stored and read back.",
+                        (outputSelect == OUTPUT_GAUSSIAN) ? "Gaussian" : "enhanced");
+    if (pointOpChain)
+        printf("\n\tEnhanced output goes through %d generated point operations: %s.",
+                        paramFF.config.numPointOps, pointOpChain);
+    if (multiScale)
+        printf("\n\tEnhanced output collapsed from %d Laplacian levels, finest gain %.2f.",
+                        pyramidLevels, paramFF.config.detailGain[0]);
+     
+    if (zeroCopy)
+        printf("\n\tKernels are using zero copy buffers.");
+    else 
+        printf("\n\tKernels are using device buffers.");
+
+    if (borderMode != BORDER_MODE_HOST_PAD)
+        printf("\n\tBorder mode %d is handled on the device, the input is not padded.", borderMode);
+    if (useImage)
+        printf("\n\tKernels read the unpadded input image through a sampler.");
+    else if (paramFF.config.useLds == LDS_MODE_SHUFFLE)
+        printf("\n\tKernels share row taps through sub-group shuffles.");
+    else if (paramFF.config.useLds)
+        printf("\n\tKernels are using Lds memory for input.");
+    else 
+        printf("\n\tKernels are not using Lds memory for input.");
+
+    printf("\n\nRunning for %d iterations\n\n", loopCnt);
+
+    /***************************************************************************
+    * Warm-up run of OpenCL Gaussian filters                            
+    **************************************************************************/
+    if (run(&infoDeviceOcl, &paramFF, dataTransfer) != true)
+    {
+        printf("Error in run.\n");
+        return -1;
+    }
+    clFinish(infoDeviceOcl.mQueue);
+
+    /*******************************************************************************
+    * Get Performance data
+    *******************************************************************************/
+    timer t_timer;
+    timerStart(&t_timer);
+
+    for (int i = 0; i < loopCnt; i++)
+    {
+        if (run(&infoDeviceOcl, &paramFF, dataTransfer) != true)
+        {
+            printf("Error in run.\n");
+            return -1;
+        }
+
+        if (!optimizedPipeline)
+        {
+            clFinish(infoDeviceOcl.mQueue);
+        }
+    }
+    clFinish(infoDeviceOcl.mQueue);
+
+    double time_ms = timerCurrent(&t_timer);
+    time_ms = 1000 * (time_ms / loopCnt);
+
+    if (zeroCopy)
+        printf("Average time taken per iteration using zero-copy buffer: %f msec\n", time_ms);
+    else
+        printf("Average time taken per iteration using device-memory with data-transfer: %f msec\n", time_ms);
+    if (frames > 1)
+        printf("Average time taken per frame: %f msec\n", time_ms / frames);
+    
+    /*******************************************************************************
+    * Get Performance data without data transfer in case of using device-memory
+    *******************************************************************************/
+    if (!zeroCopy)
+    {
+        
+        timerStart(&t_timer);
+
+        for (int i = 0; i < loopCnt; i++)
+        {
+            if (run(&infoDeviceOcl, &paramFF, 0) != true)
+            {
+                printf("Error in run.\n");
+                return -1;
+            }
+
+            if (!optimizedPipeline)
+            {
+                clFinish(infoDeviceOcl.mQueue);
+            }
+        }
+        clFinish(infoDeviceOcl.mQueue);
+
+        double time_ms = timerCurrent(&t_timer);
+        time_ms = 1000 * (time_ms / loopCnt);
+
+        printf("Average time taken per iteration using device-memory without any data-transfer: %f msec\n", time_ms);
+    }
+
+
+    /***************************************************************************
     * Save separable and non-separable filter output images                  
     **************************************************************************/
     if (!saveOutputs(&paramFF, gaussianOutputImage, enhancedOutputImage, bitWidth))
@@ -358,6 +988,12 @@ int main(int argc, char **argv)
         return -1;
     }
     
+    /***************************************************************************
+    * Compare the Gaussian output with the CPU reference
+    **************************************************************************/
+    if (verify)
+        verifyOutput(&paramFF, bitWidth);
+
     /***************************************************************************
     * Destpry memory and cleanup OpenCL runtime                              
     **************************************************************************/
@@ -376,19 +1012,24 @@ int main(int argc, char **argv)
  *  @param[in/out] paramFF      : Structure holds all parameters required 
  *                                 by the sample
  *  @param[in] inputImage       : input imaage name
- *  @param[in] filterSize       : filter size (only 3 and 5 are currently supported)
- *  @param[in] bitWidth         : 8 bit or 16 bit input
+ *  @param[in] config           : filter size, bit width, filter mode and the
+ *                                kernel build switches
  *  @param[in] deviceNum        : device on which to run OpenCL kernels
- *  @param[in] useLds           : Should the OpenCL kernel use LDS memory for input
+ *  @param[in] zeroCopy         : Should zero copy buffers be used
+ *  @param[in] autotune         : Time the candidate work-group tiles and keep
+ *                                the fastest, unless config sets one
  *
  *  @return bool : true if successful; otherwise false.
  *******************************************************************************
  */
 bool init(DeviceInfo *infoDeviceOcl, filters *paramFF,
-                const char *inputImage, cl_int filterSize, 
-                cl_uint bitWidth, cl_uint deviceNum, cl_int useLds, cl_int zeroCopy, cl_int useIntrinsics)
+                const char *inputImage, filterConfig *config,
+                cl_uint deviceNum, cl_int zeroCopy, cl_int autotune)
 {
-    paramFF->filterSize = filterSize;
+    cl_uint bitWidth = config->bitWidth;
+
+    paramFF->config = *config;
+    paramFF->filterSize = config->filtSize;
     
     /***************************************************************************
      * read the input image                                                   
@@ -399,6 +1040,11 @@ bool init(DeviceInfo *infoDeviceOcl, filters *paramFF,
         return false;
     }
 
+    CHECK_RESULT(paramFF->config.roi.width &&
+                    (paramFF->config.roi.x + paramFF->config.roi.width > paramFF->cols ||
+                     paramFF->config.roi.y + paramFF->config.roi.height > paramFF->rows),
+                    "-roi must lie inside the %dx%d image.\n", paramFF->cols, paramFF->rows);
+
     /**************************************************************************
     * Initialize the openCL device and create context and command queue      
     ***************************************************************************/
@@ -408,6 +1054,49 @@ bool init(DeviceInfo *infoDeviceOcl, filters *paramFF,
         return false;
     }
 
+    if (paramFF->config.useImage)
+    {
+        cl_bool imageSupport = CL_FALSE;
+        clGetDeviceInfo(infoDeviceOcl->mDevice, CL_DEVICE_IMAGE_SUPPORT,
+                        sizeof(cl_bool), &imageSupport, NULL);
+        CHECK_RESULT(imageSupport != CL_TRUE, "Device does not support images, -useImage 1 is not available.\n");
+    }
+
+    /* Resolve the shuffle fallback before the tile is checked against LDS */
+    if (paramFF->config.useLds == LDS_MODE_SHUFFLE &&
+        subgroupShuffleExt(infoDeviceOcl->mDevice) == SUBGROUP_EXT_NONE)
+    {
+        printf("Device has no sub-group shuffle extension, -useLds 2 falls back to the LDS tile.\n");
+        paramFF->config.useLds = 1;
+    }
+
+    if (paramFF->config.halfPrecision && !deviceHasExtension(infoDeviceOcl->mDevice, "cl_khr_fp16"))
+    {
+        printf("Device has no cl_khr_fp16, -halfPrecision 1 falls back to float accumulation.\n");
+        paramFF->config.halfPrecision = 0;
+    }
+
+    /* The persistent kernel runs one work-group per compute unit */
+    if (paramFF->config.persistent)
+    {
+        clGetDeviceInfo(infoDeviceOcl->mDevice, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint),
+                        &(paramFF->config.persistentGroups), NULL);
+    }
+
+    /* On CPU devices a work-item walking a strip with a private row ring fits
+       better than a work-group tile, the direct scalar kernels switch to it */
+    cl_device_type deviceType = 0;
+    clGetDeviceInfo(infoDeviceOcl->mDevice, CL_DEVICE_TYPE, sizeof(cl_device_type),
+                    &deviceType, NULL);
+    paramFF->config.strip = (deviceType & CL_DEVICE_TYPE_CPU) &&
+                    paramFF->config.filterMode == FILTER_MODE_DIRECT &&
+                    paramFF->config.useLds != LDS_MODE_SHUFFLE && paramFF->config.channels == 1 &&
+                    paramFF->config.rowsPerItem == 1 && paramFF->config.vecWidth == 1 &&
+                    !paramFF->config.halfPrecision && !paramFF->config.fixedPoint &&
+                    !paramFF->config.useImage && paramFF->config.borderMode == BORDER_MODE_HOST_PAD &&
+                    !paramFF->config.persistent && !paramFF->config.roi.width &&
+                    !paramFF->config.batched && !packedBits(bitWidth);
+
     /**************************************************************************
     * Create the memory needed by the pipeline                               
     ***************************************************************************/
@@ -417,13 +1106,54 @@ bool init(DeviceInfo *infoDeviceOcl, filters *paramFF,
         return false;
     }
 
+    paramFF->config.filterCoeff = paramFF->gaussianFilterCpu;
+    paramFF->config.filterCoeff1D = paramFF->gaussianFilter1DCpu;
+    paramFF->config.filterCoeffFixed = paramFF->gaussianFilterFixedCpu;
+
+    /* Folding needs symmetric float coefficients, and only the separable
+       passes and the folded 2D kernels fold. buildKernels picks the folded 2D
+       kernels when no other direct variant is selected */
+    filterConfig *active = &(paramFF->config);
+    cl_int foldedVariant = (active->filterMode == FILTER_MODE_SEPARABLE) ||
+                    (active->filterMode == FILTER_MODE_DIRECT && !active->persistent &&
+                     !packedBits(active->bitWidth) && !active->strip &&
+                     active->rowsPerItem == 1 && !active->halfPrecision && active->vecWidth == 1 &&
+                     !active->useImage && active->borderMode == BORDER_MODE_HOST_PAD &&
+                     active->useLds != LDS_MODE_SHUFFLE && !active->fixedPoint);
+    paramFF->config.foldCoeff = config->foldCoeff && foldedVariant && active->channels == 1 && !active->batched &&
+                    isSymmetricCoeff(paramFF->filterSize, paramFF->gaussianFilter1DCpu,
+                                    paramFF->gaussianFilterCpu);
+
+    /**************************************************************************
+    * Pick the work-group tile: -localSize, else -autotune, else the tile
+    * stored for this device and configuration, else the default
+    ***************************************************************************/
+    if (paramFF->config.localXRes == 0)
+    {
+        if (autotune)
+        {
+            if (autotuneLocalSize(infoDeviceOcl, paramFF) == false)
+            {
+                printf("Error in autotuneLocalSize.\n");
+                return false;
+            }
+        }
+        else if (loadTunedLocalSize(infoDeviceOcl, paramFF) == false)
+        {
+            paramFF->config.localXRes = LOCAL_XRES;
+            paramFF->config.localYRes = LOCAL_YRES;
+        }
+    }
+    else if (autotune)
+    {
+        printf("-localSize is given, -autotune is ignored.\n");
+    }
+
     /***************************************************************************
     * Build the Gaussin Filter OpenCL kernel                         
     ***************************************************************************/
     if (buildKernels(infoDeviceOcl->mCtx, infoDeviceOcl->mDevice,
-                    &(paramFF->gaussianKernel), &(paramFF->enhancedKernel), &(paramFF->combinedKernel), 
-                    filterSize, bitWidth, useLds, useIntrinsics)
-                    == false)
+                    &(paramFF->config), &(paramFF->kernels)) == false)
     {
         printf("Error in buildGaussianFilterKernel.\n");
         return false;
@@ -432,12 +1162,8 @@ bool init(DeviceInfo *infoDeviceOcl, filters *paramFF,
     /**************************************************************************
     * Sets the Gaussian Filter OpenCL kernel arguments                     
     **************************************************************************/
-    if (setKernelArgs(paramFF->gaussianKernel,
-                    paramFF->enhancedKernel,
-                    paramFF->combinedKernel,
-                    paramFF->input, paramFF->gaussianOutput, paramFF->enhancedOutput,
-                    paramFF->gaussianFilter, paramFF->cols, 
-                    paramFF->rows, paramFF->filterSize) == false)
+    if (setKernelArgs(&(paramFF->kernels), &(paramFF->mem), &(paramFF->config),
+                    paramFF->cols, paramFF->rows) == false)
     {
         printf("Error in setGaussianFilterKernelArgs.\n");
         return false;
@@ -454,12 +1180,12 @@ bool init(DeviceInfo *infoDeviceOcl, filters *paramFF,
  *  @param[in/out] infoDeviceOcl : Structure which holds openCL related params
  *  @param[in/out] paramFF      : Structure holds all parameters required
  *                                 by the sample
- *  @param[in] bitWidth         : 8 bit or 16 bit input
+ *  @param[in] dataTransfer     : Should the input be sent and the outputs read back
  *
  *  @return bool : true if successful; otherwise false.
  *******************************************************************************
  */
-bool run(DeviceInfo *infoDeviceOcl, filters *paramFF, cl_uint bitWidth, cl_uint runCombinedKernel, cl_uint dataTransfer)
+bool run(DeviceInfo *infoDeviceOcl, filters *paramFF, cl_uint dataTransfer)
 {
     cl_int status;
 
@@ -471,28 +1197,79 @@ bool run(DeviceInfo *infoDeviceOcl, filters *paramFF, cl_uint bitWidth, cl_uint
         /**************************************************************************
         * Send the input image data to the device
         ***************************************************************************/
-        status = clEnqueueWriteBuffer(infoDeviceOcl->mQueue, paramFF->input,
-                        CL_FALSE, 0, paramFF->paddedRows * paramFF->paddedCols * sizeof(cl_uchar)
-                                        * (bitWidth / 8), paramFF->inputImg, 0,
-                        NULL, NULL);
-        CHECK_RESULT(status != CL_SUCCESS,
-                        "Error in clEnqueueWriteBuffer. Status: %d\n", status);
+        if (paramFF->config.useImage)
+        {
+            size_t origin[3] = {0, 0, 0};
+            size_t region[3] = {paramFF->cols, paramFF->rows, 1};
+            status = clEnqueueWriteImage(infoDeviceOcl->mQueue, paramFF->mem.input,
+                            CL_FALSE, origin, region, 0, 0, paramFF->inputImg, 0,
+                            NULL, NULL);
+            CHECK_RESULT(status != CL_SUCCESS,
+                            "Error in clEnqueueWriteImage. Status: %d\n", status);
+        }
+        else if (paramFF->packedImg)
+        {
+            status = clEnqueueWriteBuffer(infoDeviceOcl->mQueue, paramFF->mem.input,
+                            CL_FALSE, 0, paramFF->paddedRows * paramFF->packedPitch, paramFF->packedImg, 0,
+                            NULL, NULL);
+            CHECK_RESULT(status != CL_SUCCESS,
+                            "Error in clEnqueueWriteBuffer. Status: %d\n", status);
+        }
+        else if (paramFF->config.roi.width)
+        {
+            /* Only the input read by the region of interest launch, the
+               rectangle is at the same place in the host and device buffers */
+            roiRect inRect;
+            roiInputRect(&paramFF->config, paramFF->cols, paramFF->rows, &inRect);
+
+            size_t origin[3] = {inRect.x * paramFF->pixelBytes, inRect.y, 0};
+            size_t region[3] = {inRect.width * paramFF->pixelBytes, inRect.height, 1};
+            size_t pitch = paramFF->paddedCols * paramFF->pixelBytes;
+            status = clEnqueueWriteBufferRect(infoDeviceOcl->mQueue, paramFF->mem.input,
+                            CL_FALSE, origin, origin, region, pitch, 0, pitch, 0,
+                            paramFF->inputImg, 0, NULL, NULL);
+            CHECK_RESULT(status != CL_SUCCESS,
+                            "Error in clEnqueueWriteBufferRect. Status: %d\n", status);
+        }
+        else
+        {
+            status = clEnqueueWriteBuffer(infoDeviceOcl->mQueue, paramFF->mem.input,
+                            CL_FALSE, 0, paramFF->config.frames * paramFF->paddedRows * paramFF->paddedCols * sizeof(cl_uchar)
+                                            * paramFF->pixelBytes, paramFF->inputImg, 0,
+                            NULL, NULL);
+            CHECK_RESULT(status != CL_SUCCESS,
+                            "Error in clEnqueueWriteBuffer. Status: %d\n", status);
+        }
 
-        /**************************************************************************
-        * Send the filters to the device
-        ***************************************************************************/
-        status = clEnqueueWriteBuffer(infoDeviceOcl->mQueue,
-                        paramFF->gaussianFilter, CL_FALSE, 0, paramFF->filterSize
-                                        * paramFF->filterSize * sizeof(cl_float),
-                        paramFF->gaussianFilterCpu, 0, NULL, NULL);
-        CHECK_RESULT(status != CL_SUCCESS,
-                        "Error in clEnqueueWriteBuffer. Status: %d\n", status);
+        /* The filter coefficients are uploaded once in createMemory */
     }
     /**************************************************************************
      * Run the gaussianFilter OpenCL kernel.
      ***************************************************************************/
-    runKernels(infoDeviceOcl->mQueue, paramFF->gaussianKernel, paramFF->enhancedKernel, 
-        paramFF->combinedKernel, runCombinedKernel, paramFF->cols, paramFF->rows);
+    runKernels(infoDeviceOcl->mQueue, &(paramFF->kernels), &(paramFF->config),
+        paramFF->cols, paramFF->rows, NULL);
+
+    if (paramFF->config.pyramidLevels)
+    {
+        CHECK_RESULT(runPyramid(infoDeviceOcl->mQueue, &(paramFF->kernels), &(paramFF->mem),
+                        &(paramFF->config), paramFF->cols, paramFF->rows) == false,
+                        "Error in runPyramid.\n");
+    }
+
+    /* Replaces the enhanced output, all levels stay on the device */
+    if (paramFF->config.multiScale)
+    {
+        CHECK_RESULT(runLaplacianEnhance(infoDeviceOcl->mQueue, &(paramFF->kernels), &(paramFF->mem),
+                        &(paramFF->config), paramFF->cols, paramFF->rows) == false,
+                        "Error in runLaplacianEnhance.\n");
+    }
+
+    if (paramFF->config.satRadius)
+    {
+        CHECK_RESULT(runBoxMean(infoDeviceOcl->mQueue, &(paramFF->kernels), &(paramFF->mem),
+                        &(paramFF->config), paramFF->cols, paramFF->rows) == false,
+                        "Error in runBoxMean.\n");
+    }
 
         /**************************************************************************
     * Transfer the data to host if zero-copy is not being used
@@ -502,24 +1279,115 @@ bool run(DeviceInfo *infoDeviceOcl, filters *paramFF, cl_uint bitWidth, cl_uint
         /**************************************************************************
          * Get the results back to host
          ***************************************************************************/
-        status = clEnqueueReadBuffer(infoDeviceOcl->mQueue, paramFF->gaussianOutput,
-                        CL_FALSE, 0, paramFF->cols * paramFF->rows
-                                        * sizeof(cl_uchar) * (bitWidth / 8),
-                        paramFF->gaussianOutputImg, 0, NULL, NULL);
-        CHECK_RESULT(status != CL_SUCCESS,
-                        "Error in clEnqueueReadBuffer. Status: %d\n", status);
-
-        status = clEnqueueReadBuffer(infoDeviceOcl->mQueue, paramFF->enhancedOutput,
-                        CL_FALSE, 0, paramFF->cols * paramFF->rows
-                                        * sizeof(cl_uchar) * (bitWidth / 8),
-                        paramFF->enhancedOutputImg, 0, NULL, NULL);
-        CHECK_RESULT(status != CL_SUCCESS,
-                        "Error in clEnqueueReadBuffer. Status: %d\n", status);
+        if (paramFF->config.roi.width)
+        {
+            /* Only the region of interest, into place in the full-size outputs */
+            roiRect *roi = &paramFF->config.roi;
+            size_t origin[3] = {roi->x * paramFF->pixelBytes, roi->y, 0};
+            size_t region[3] = {roi->width * paramFF->pixelBytes, roi->height, 1};
+            size_t pitch = paramFF->cols * paramFF->pixelBytes;
+
+            if (paramFF->config.outputSelect != OUTPUT_ENHANCED)
+            {
+                status = clEnqueueReadBufferRect(infoDeviceOcl->mQueue, paramFF->mem.gaussianOutput,
+                                CL_FALSE, origin, origin, region, pitch, 0, pitch, 0,
+                                paramFF->gaussianOutputImg, 0, NULL, NULL);
+                CHECK_RESULT(status != CL_SUCCESS,
+                                "Error in clEnqueueReadBufferRect. Status: %d\n", status);
+            }
+
+            if (paramFF->config.outputSelect != OUTPUT_GAUSSIAN)
+            {
+                status = clEnqueueReadBufferRect(infoDeviceOcl->mQueue, paramFF->mem.enhancedOutput,
+                                CL_FALSE, origin, origin, region, pitch, 0, pitch, 0,
+                                paramFF->enhancedOutputImg, 0, NULL, NULL);
+                CHECK_RESULT(status != CL_SUCCESS,
+                                "Error in clEnqueueReadBufferRect. Status: %d\n", status);
+            }
+        }
+        else
+        {
+            if (paramFF->config.outputSelect != OUTPUT_ENHANCED)
+            {
+                status = clEnqueueReadBuffer(infoDeviceOcl->mQueue, paramFF->mem.gaussianOutput,
+                                CL_FALSE, 0, paramFF->config.frames * paramFF->cols * paramFF->rows
+                                                * sizeof(cl_uchar) * paramFF->pixelBytes,
+                                paramFF->gaussianOutputImg, 0, NULL, NULL);
+                CHECK_RESULT(status != CL_SUCCESS,
+                                "Error in clEnqueueReadBuffer. Status: %d\n", status);
+            }
+
+            if (paramFF->config.outputSelect != OUTPUT_GAUSSIAN)
+            {
+                status = clEnqueueReadBuffer(infoDeviceOcl->mQueue, paramFF->mem.enhancedOutput,
+                                CL_FALSE, 0, paramFF->config.frames * paramFF->cols * paramFF->rows
+                                                * sizeof(cl_uchar) * paramFF->pixelBytes,
+                                paramFF->enhancedOutputImg, 0, NULL, NULL);
+                CHECK_RESULT(status != CL_SUCCESS,
+                                "Error in clEnqueueReadBuffer. Status: %d\n", status);
+            }
+        }
+
+        if (paramFF->config.pyramidLevels)
+        {
+            status = clEnqueueReadBuffer(infoDeviceOcl->mQueue, paramFF->mem.pyramid,
+                            CL_FALSE, 0, paramFF->pyramid.size * paramFF->pixelBytes,
+                            paramFF->pyramidImg, 0, NULL, NULL);
+            CHECK_RESULT(status != CL_SUCCESS,
+                            "Error in clEnqueueReadBuffer. Status: %d\n", status);
+        }
+
+        if (paramFF->config.satRadius)
+        {
+            status = clEnqueueReadBuffer(infoDeviceOcl->mQueue, paramFF->mem.boxMeanOutput,
+                            CL_FALSE, 0, paramFF->cols * paramFF->rows * paramFF->pixelBytes,
+                            paramFF->boxMeanImg, 0, NULL, NULL);
+            CHECK_RESULT(status != CL_SUCCESS,
+                            "Error in clEnqueueReadBuffer. Status: %d\n", status);
+        }
     }
     
         return true;
 }
 
+/**
+ *******************************************************************************
+ *  @fn     packInputFrame
+ *  @brief  This function stores the bitmap pixels of one frame in the
+ *          configured channel layout, inside the padding of the frame
+ *
+ *  @param[in] paramFF     : Pointer to structure
+ *  @param[in] pixelData   : cols x rows bitmap pixels
+ *  @param[out] frame      : paddedCols x paddedRows frame of inputImg
+ *  @param[in] bitWidth    : 8, 10, 12 or 16 bit input, stored as ushort above 8
+ *
+ *  @return void
+ *******************************************************************************
+ */
+static void packInputFrame(filters *paramFF, const uchar4 *pixelData, cl_uchar *frame,
+                cl_uint bitWidth)
+{
+    cl_int filterRadius = (paramFF->paddedCols - paramFF->cols) / 2;
+
+    for (cl_uint c = 0; c < storedChannels(&paramFF->config); c++)
+    {
+        for (cl_uint i = filterRadius; i < paramFF->rows + filterRadius; i++)
+        {
+            for (cl_uint j = filterRadius; j < paramFF->cols + filterRadius; j++)
+            {
+                uchar4 pixel = pixelData[(i - filterRadius) * paramFF->cols + (j - filterRadius)];
+                cl_uchar value = (c == 0) ? pixel.x : (c == 1) ? pixel.y : (c == 2) ? pixel.z : pixel.w;
+                size_t pos = sampleIndex(&paramFF->config, c, j, i, paramFF->paddedCols, paramFF->paddedRows);
+
+                if (bitWidth > 8)
+                    ((cl_ushort *) frame)[pos] = (cl_ushort)value;
+                else
+                    ((cl_uchar *) frame)[pos] = value;
+            }
+        }
+    }
+}
+
 /**
  *******************************************************************************
  *  @fn     readInput
@@ -551,15 +1419,25 @@ bool readInput(filters *paramFF, const char *inputImage, cl_uint bitWidth)
     paramFF->rows = paramFF->inputBitmap.getHeight();
     paramFF->cols = paramFF->inputBitmap.getWidth();
 
-    paramFF->paddedRows = paramFF->rows + paramFF->filterSize - 1;
-    paramFF->paddedCols = paramFF->cols + paramFF->filterSize - 1;
+    /* The image path and device-side borders need no padding */
+    cl_uint padding = (paramFF->config.useImage || paramFF->config.borderMode != BORDER_MODE_HOST_PAD) ?
+                    0 : paramFF->filterSize - 1;
+
+    /* Reflect and wrap fold each out of range tap back in once */
+    CHECK_RESULT(paramFF->config.borderMode >= BORDER_MODE_REFLECT &&
+                    (paramFF->filterSize / 2 > paramFF->rows || paramFF->filterSize / 2 > paramFF->cols),
+                    "Image is smaller than the filter radius.\n");
 
-    cl_int filterRadius = paramFF->filterSize / 2;
+    paramFF->paddedRows = paramFF->rows + padding;
+    paramFF->paddedCols = paramFF->cols + padding;
+    paramFF->pixelBytes = ((bitWidth + 7) / 8) * storedChannels(&paramFF->config);
 
-    paramFF->inputImg = (cl_uchar *) malloc(paramFF->paddedCols
-                    * paramFF->paddedRows * sizeof(cl_uchar) * bitWidth / 8);
-    memset(paramFF->inputImg, 0, paramFF->paddedCols * paramFF->paddedRows
-                    * sizeof(cl_uchar) * bitWidth / 8);
+    paramFF->inputImg = (cl_uchar *) malloc(paramFF->config.frames * paramFF->paddedCols
+                    * paramFF->paddedRows * sizeof(cl_uchar) * paramFF->pixelBytes);
+    CHECK_RESULT(paramFF->inputImg == NULL, "Malloc failed.\n");
+    if (padding)
+        memset(paramFF->inputImg, 0, paramFF->paddedCols * paramFF->paddedRows
+                    * sizeof(cl_uchar) * paramFF->pixelBytes);
 
 
     // get the pointer to pixel data
@@ -571,60 +1449,160 @@ bool readInput(filters *paramFF, const char *inputImage, cl_uint bitWidth)
     }
 
     /**************************************************************************
-     * Using only r channel of the image. 
+     * Using only r channel of the image, or r, g, b (and a) in the
+     * configured layout.
      * Pad the input image.
      **************************************************************************/
-    if (bitWidth == 16)
+    CHECK_RESULT(bitWidth != 8 && bitWidth != 16 && !packedBits(bitWidth),
+                    "Un-supported bitWidth, only 8, 10, 12 and 16 bits are supported");
+
+    packInputFrame(paramFF, pixelData, paramFF->inputImg, bitWidth);
+
+    /* 10 and 12 bit input is sent as a bitstream, each padded row starting on
+       a byte. inputImg keeps the ushort copy for the CPU reference */
+    paramFF->packedImg = NULL;
+    paramFF->packedPitch = 0;
+    if (packedBits(bitWidth))
     {
-        for (cl_uint i = filterRadius; i < paramFF->rows + filterRadius; i++)
-        {
-            for (cl_uint j = filterRadius; j < paramFF->cols + filterRadius; j++)
-            {
-                ((cl_ushort *) paramFF->inputImg)[i * paramFF->paddedCols + j]
-                                = (cl_ushort)(pixelData[(i - filterRadius) * paramFF->cols + (j - filterRadius)].x);
-            }
-        }
-
-    }
-    else if (bitWidth == 8)
-    {
-        for (cl_uint i = filterRadius; i < paramFF->rows + filterRadius; i++)
-        {
-            for (cl_uint j = filterRadius; j < paramFF->cols + filterRadius; j++)
-            {
-                ((cl_uchar *) paramFF->inputImg)[i * paramFF->paddedCols + j]
-                                = (cl_uchar)(pixelData[(i - filterRadius) * paramFF->cols + (j - filterRadius)].x);
-            }
-        }
+        paramFF->packedPitch = packedRowBytes(paramFF->paddedCols, bitWidth);
+        paramFF->packedImg = (cl_uchar *) malloc(paramFF->paddedRows * paramFF->packedPitch);
+        CHECK_RESULT(paramFF->packedImg == NULL, "Malloc failed.\n");
+        for (cl_uint i = 0; i < paramFF->paddedRows; i++)
+            packPixels((cl_ushort *)paramFF->inputImg + i * paramFF->paddedCols, paramFF->paddedCols,
+                            bitWidth, paramFF->packedImg + i * paramFF->packedPitch);
     }
-    else
+
+    /* The frame queue repeats the input, a batch packs its images after it.
+       Each frame copies the zero padding of the first one */
+    size_t frameBytes = paramFF->paddedCols * paramFF->paddedRows * sizeof(cl_uchar) * paramFF->pixelBytes;
+    const char *nextImage = paramFF->batchImages;
+    for (cl_uint f = 1; f < paramFF->config.frames; f++)
     {
-        CHECK_RESULT(false, "Un-supported bitWidth, only 8 and 16 bits are supported");
+        memcpy(paramFF->inputImg + f * frameBytes, paramFF->inputImg, frameBytes);
+        if (nextImage == NULL)
+            continue;
+
+        char frameImage[1024];
+        size_t nameLen = strcspn(nextImage, ",");
+        CHECK_RESULT(nameLen >= sizeof(frameImage), "Batch image name too long.\n");
+        memcpy(frameImage, nextImage, nameLen);
+        frameImage[nameLen] = '\0';
+        nextImage += nameLen + (nextImage[nameLen] == ',');
+
+        SDKBitMap frameBitmap;
+        frameBitmap.load(frameImage);
+        CHECK_RESULT(!frameBitmap.isLoaded(), "Failed to load batch image %s.\n", frameImage);
+        CHECK_RESULT((cl_uint)frameBitmap.getWidth() != paramFF->cols || (cl_uint)frameBitmap.getHeight() != paramFF->rows,
+                        "Batch image %s must be %dx%d like the input.\n", frameImage, paramFF->cols, paramFF->rows);
+        CHECK_RESULT(frameBitmap.getPixels() == NULL, "Failed to read pixel Data!");
+
+        packInputFrame(paramFF, frameBitmap.getPixels(), paramFF->inputImg + f * frameBytes, bitWidth);
     }
 
     /***********************************************************************
-     * get filter 
+     * get filter. The shipped 3x3 and 5x5 tables are used unless a sigma is
+     * given, every other size is generated.
      ***********************************************************************/
-    if (paramFF->filterSize == 3)
+    cl_uint filterSize = paramFF->filterSize;
+    paramFF->gaussianFilterCpu = (cl_float *) malloc(filterSize * filterSize * sizeof(cl_float));
+    paramFF->gaussianFilter1DCpu = (cl_float *) malloc(filterSize * sizeof(cl_float));
+    CHECK_RESULT(paramFF->gaussianFilterCpu == NULL || paramFF->gaussianFilter1DCpu == NULL,
+                    "Malloc failed.\n");
+
+    if (paramFF->config.sigma <= 0.0f && filterSize == 3)
     {
-        paramFF->gaussianFilterCpu = gaussianFilterCoeff_3x3;
+        memcpy(paramFF->gaussianFilterCpu, gaussianFilterCoeff_3x3, sizeof(gaussianFilterCoeff_3x3));
+        memcpy(paramFF->gaussianFilter1DCpu, gaussianFilterCoeff1D_3, sizeof(gaussianFilterCoeff1D_3));
     }
-    else if (paramFF->filterSize == 5)
+    else if (paramFF->config.sigma <= 0.0f && filterSize == 5)
     {
-        paramFF->gaussianFilterCpu = gaussianFilterCoeff_5x5;
+        memcpy(paramFF->gaussianFilterCpu, gaussianFilterCoeff_5x5, sizeof(gaussianFilterCoeff_5x5));
+        memcpy(paramFF->gaussianFilter1DCpu, gaussianFilterCoeff1D_5, sizeof(gaussianFilterCoeff1D_5));
     }
-    else if (paramFF->filterSize == 7)
+    else
     {
-        paramFF->gaussianFilterCpu = gaussianFilterCoeff_7x7;
+        generateGaussianCoeff(filterSize, paramFF->config.sigma,
+                        paramFF->gaussianFilter1DCpu, paramFF->gaussianFilterCpu);
     }
-    else
+
+    /* The fixed-point kernels read integer weights from the same buffer */
+    paramFF->gaussianFilterFixedCpu = NULL;
+    paramFF->fixedPointError = 0.0f;
+    if (paramFF->config.fixedPoint)
+    {
+        paramFF->gaussianFilterFixedCpu = (cl_uint *) malloc(filterSize * filterSize * sizeof(cl_uint));
+        CHECK_RESULT(paramFF->gaussianFilterFixedCpu == NULL, "Malloc failed.\n");
+        paramFF->fixedPointError = quantizeGaussianCoeff(filterSize * filterSize,
+                        paramFF->gaussianFilterCpu, FIXED_POINT_SHIFT, paramFF->gaussianFilterFixedCpu);
+    }
+
+    paramFF->halfPrecisionError = 0.0f;
+    if (paramFF->config.halfPrecision)
+        paramFF->halfPrecisionError = halfPrecisionError(filterSize * filterSize,
+                        paramFF->gaussianFilterCpu, 255.0f);
+
+    /* The radius map must match the input, its r channel scales satRadius */
+    paramFF->radiusMapImg = NULL;
+    if (paramFF->config.radiusMap)
     {
-        paramFF->gaussianFilterCpu = gaussianFilterCoeff_9x9;
+        SDKBitMap mapBitmap;
+        mapBitmap.load(paramFF->radiusMapImage);
+        CHECK_RESULT(!mapBitmap.isLoaded(), "Failed to load radius map %s.\n", paramFF->radiusMapImage);
+        CHECK_RESULT((cl_uint)mapBitmap.getWidth() != paramFF->cols || (cl_uint)mapBitmap.getHeight() != paramFF->rows,
+                        "Radius map must be %dx%d like the input.\n", paramFF->cols, paramFF->rows);
+
+        uchar4 *mapPixels = mapBitmap.getPixels();
+        paramFF->radiusMapImg = (cl_uchar *) malloc(paramFF->rows * paramFF->cols);
+        CHECK_RESULT(mapPixels == NULL || paramFF->radiusMapImg == NULL, "Malloc failed.\n");
+        for (cl_uint i = 0; i < paramFF->rows * paramFF->cols; i++)
+            paramFF->radiusMapImg[i] = mapPixels[i].x;
     }
     
     return true;
 }
 
+/**
+ *******************************************************************************
+ *  @fn     packOutput
+ *  @brief  This function converts an output image to the bitmap's uchar4
+ *          pixels. A single channel is written to r, g and b
+ *
+ *  @param[in] paramFF     : Pointer to structure
+ *  @param[in] img         : output image in the configured channel layout
+ *  @param[in] bitWidth    : 8 bit or 16 bit output
+ *  @param[in] width       : image width
+ *  @param[in] height      : image height
+ *  @param[out] data       : width x height bitmap pixels
+ *
+ *  @return void
+ *******************************************************************************
+ */
+static void packOutput(filters *paramFF, const cl_uchar *img, cl_uint bitWidth,
+                cl_uint width, cl_uint height, uchar4 *data)
+{
+    memset(data, 0, height * width * sizeof(uchar4));
+
+    for (cl_uint i = 0; i < height; i++)
+    {
+        for (cl_uint j = 0; j < width; j++)
+        {
+            cl_uchar value[4] = { 0, 0, 0, 0 };
+            for (cl_uint c = 0; c < paramFF->config.channels; c++)
+            {
+                size_t pos = sampleIndex(&paramFF->config, c, j, i, width, height);
+                value[c] = (bitWidth == 8) ? img[pos] : (cl_uchar)((const cl_ushort *)img)[pos];
+            }
+            if (paramFF->config.channels == 1)
+                value[1] = value[2] = value[0];
+
+            data[i * width + j].x = value[0];
+            data[i * width + j].y = value[1];
+            data[i * width + j].z = value[2];
+            data[i * width + j].w = value[3];
+        }
+    }
+}
+
 /**
  *******************************************************************************
  *  @fn     saveOutput
@@ -650,67 +1628,76 @@ bool saveOutputs(filters *paramFF, const char *gaussianOutputImage,
     }
 
     //Save gaussian filter output
-    memset(data, 0, paramFF->rows * paramFF->cols * sizeof(uchar4));
-    if (bitWidth == 8)
-    {      
-        for (cl_uint i = 0; i < paramFF->rows; i++)
-        {
-            for (cl_uint j = 0; j < paramFF->cols; j++)
-            {
-                data[i * paramFF->cols + j].x = (cl_uchar)paramFF->gaussianOutputImg[i * paramFF->cols + j];
-                data[i * paramFF->cols + j].y = (cl_uchar)paramFF->gaussianOutputImg[i * paramFF->cols + j];
-                data[i * paramFF->cols + j].z = (cl_uchar)paramFF->gaussianOutputImg[i * paramFF->cols + j];
-            }
-        }
+    if (paramFF->config.outputSelect != OUTPUT_ENHANCED)
+    {
+        packOutput(paramFF, paramFF->gaussianOutputImg, bitWidth, paramFF->cols, paramFF->rows, data);
+        // write the output bmp file
+        paramFF->inputBitmap.write(gaussianOutputImage, paramFF->cols, paramFF->rows, (unsigned int *)data);
     }
-    else
+
+    //Save enhanced image output
+    if (paramFF->config.outputSelect != OUTPUT_GAUSSIAN)
     {
-        for (cl_uint i = 0; i < paramFF->rows; i++)
+        packOutput(paramFF, paramFF->enhancedOutputImg, bitWidth, paramFF->cols, paramFF->rows, data);
+        // write the output bmp file
+        paramFF->inputBitmap.write(enhancedOutputImage, paramFF->cols, paramFF->rows, (unsigned int *)data);
+    }
+
+    //Save the other frames of a batch of images
+    for (cl_uint f = 1; paramFF->batchImages && f < paramFF->config.frames; f++)
+    {
+        size_t frameOffset = f * paramFF->rows * paramFF->cols * paramFF->pixelBytes;
+        char frameImage[64];
+
+        if (paramFF->config.outputSelect != OUTPUT_ENHANCED)
         {
-            for (cl_uint j = 0; j < paramFF->cols; j++)
-            {
-                data[i * paramFF->cols + j].x = (cl_uchar)((cl_ushort *)paramFF->gaussianOutputImg)[i * paramFF->cols + j];
-                data[i * paramFF->cols + j].y = (cl_uchar)((cl_ushort *)paramFF->gaussianOutputImg)[i * paramFF->cols + j];
-                data[i * paramFF->cols + j].z = (cl_uchar)((cl_ushort *)paramFF->gaussianOutputImg)[i * paramFF->cols + j];
-            }
+            snprintf(frameImage, sizeof(frameImage), BATCH_GAUSSIAN_OUTPUT_IMAGE, f);
+            packOutput(paramFF, paramFF->gaussianOutputImg + frameOffset, bitWidth, paramFF->cols, paramFF->rows, data);
+            paramFF->inputBitmap.write(frameImage, paramFF->cols, paramFF->rows, (unsigned int *)data);
         }
-    }
-    // write the output bmp file
-    paramFF->inputBitmap.write(gaussianOutputImage, paramFF->cols, paramFF->rows, (unsigned int *)data);
 
-    //Save enhanced image output
-    memset(data, 0, paramFF->rows * paramFF->cols * sizeof(uchar4));
-    if (bitWidth == 8)
-    {      
-        for (cl_uint i = 0; i < paramFF->rows; i++)
+        if (paramFF->config.outputSelect != OUTPUT_GAUSSIAN)
         {
-            for (cl_uint j = 0; j < paramFF->cols; j++)
-            {
-                data[i * paramFF->cols + j].x = (cl_uchar)paramFF->enhancedOutputImg[i * paramFF->cols + j];
-                data[i * paramFF->cols + j].y = (cl_uchar)paramFF->enhancedOutputImg[i * paramFF->cols + j];
-                data[i * paramFF->cols + j].z = (cl_uchar)paramFF->enhancedOutputImg[i * paramFF->cols + j];
-            }
+            snprintf(frameImage, sizeof(frameImage), BATCH_ENHANCED_OUTPUT_IMAGE, f);
+            packOutput(paramFF, paramFF->enhancedOutputImg + frameOffset, bitWidth, paramFF->cols, paramFF->rows, data);
+            paramFF->inputBitmap.write(frameImage, paramFF->cols, paramFF->rows, (unsigned int *)data);
         }
     }
-    else
+
+    //Save the pyramid levels, they fit in the buffer of the full image
+    for (cl_uint level = 1; level <= paramFF->config.pyramidLevels; level++)
     {
-        for (cl_uint i = 0; i < paramFF->rows; i++)
-        {
-            for (cl_uint j = 0; j < paramFF->cols; j++)
-            {
-                data[i * paramFF->cols + j].x = (cl_uchar)((cl_ushort *)paramFF->enhancedOutputImg)[i * paramFF->cols + j];
-                data[i * paramFF->cols + j].y = (cl_uchar)((cl_ushort *)paramFF->enhancedOutputImg)[i * paramFF->cols + j];
-                data[i * paramFF->cols + j].z = (cl_uchar)((cl_ushort *)paramFF->enhancedOutputImg)[i * paramFF->cols + j];
-            }
-        }
+        char levelImage[64];
+        snprintf(levelImage, sizeof(levelImage), PYRAMID_OUTPUT_IMAGE, level);
+        packOutput(paramFF, paramFF->pyramidImg + paramFF->pyramid.base[level] * paramFF->pixelBytes,
+                        bitWidth, paramFF->pyramid.width[level], paramFF->pyramid.height[level], data);
+        paramFF->inputBitmap.write(levelImage, paramFF->pyramid.width[level],
+                        paramFF->pyramid.height[level], (unsigned int *)data);
+    }
+
+    //Save the box mean
+    if (paramFF->config.satRadius)
+    {
+        packOutput(paramFF, paramFF->boxMeanImg, bitWidth, paramFF->cols, paramFF->rows, data);
+        paramFF->inputBitmap.write(BOX_MEAN_OUTPUT_IMAGE, paramFF->cols, paramFF->rows, (unsigned int *)data);
     }
-    // write the output bmp file
-    paramFF->inputBitmap.write(enhancedOutputImage, paramFF->cols, paramFF->rows, (unsigned int *)data);
 
     free(data);
 
-    printf("\nGaussian Filter output written to %s\n", gaussianOutputImage);
-    printf("Enhanced Filter output written to %s\n\n", enhancedOutputImage);
+    printf("\n");
+    if (paramFF->config.outputSelect != OUTPUT_ENHANCED)
+        printf("Gaussian Filter output written to %s\n", gaussianOutputImage);
+    if (paramFF->config.outputSelect != OUTPUT_GAUSSIAN)
+        printf("Enhanced Filter output written to %s\n", enhancedOutputImage);
+    if (paramFF->config.pyramidLevels)
+        printf("Pyramid levels 1 to %d written to gaussianPyramid_L<level>.bmp\n",
+                        paramFF->config.pyramidLevels);
+    if (paramFF->batchImages)
+        printf("Frames 1 to %d of the batch written to gaussianOutput_<frame>.bmp and enhancedOutput_<frame>.bmp\n",
+                        paramFF->config.frames - 1);
+    if (paramFF->config.satRadius)
+        printf("Box mean output written to %s\n", BOX_MEAN_OUTPUT_IMAGE);
+    printf("\n");
     
     return true;
 }
@@ -733,57 +1720,205 @@ bool createMemory(filters* paramFF, DeviceInfo *infoDeviceOcl,
 {
     cl_int err = 0;
 
+    memset(&(paramFF->mem), 0, sizeof(filterBuffers));
+
     int paddedRows = paramFF->paddedRows;
     int paddedCols = paramFF->paddedCols;
+    cl_uint frames = paramFF->config.frames;
 
-    paramFF->gaussianOutputImg = (cl_uchar *) malloc(paramFF->rows * paramFF->cols
-                    * sizeof(cl_uchar) * (bitWidth / 8));
+    /* Packed input is uploaded from its bitstream instead of inputImg */
+    size_t inputBytes = paramFF->packedImg ? paramFF->paddedRows * paramFF->packedPitch :
+                    frames * paddedRows * paddedCols * sizeof(cl_uchar) * paramFF->pixelBytes;
+    void *inputHostPtr = paramFF->packedImg ? (void *)paramFF->packedImg : (void *)paramFF->inputImg;
+
+    /* Float and fixed-point coefficients are both 4 bytes wide */
+    void *filterCoeffCpu = paramFF->config.fixedPoint ?
+                    (void *)paramFF->gaussianFilterFixedCpu : (void *)paramFF->gaussianFilterCpu;
+
+    paramFF->gaussianOutputImg = (cl_uchar *) malloc(paramFF->config.frames * paramFF->rows * paramFF->cols
+                    * sizeof(cl_uchar) * paramFF->pixelBytes);
     CHECK_RESULT(paramFF->gaussianOutputImg == NULL, "Malloc failed.\n");
 
-    paramFF->enhancedOutputImg = (cl_uchar *) malloc(paramFF->rows * paramFF->cols
-                    * sizeof(cl_uchar) * (bitWidth / 8));
+    paramFF->enhancedOutputImg = (cl_uchar *) malloc(paramFF->config.frames * paramFF->rows * paramFF->cols
+                    * sizeof(cl_uchar) * paramFF->pixelBytes);
     CHECK_RESULT(paramFF->enhancedOutputImg == NULL, "Malloc failed.\n");
 
+    /* Only the region of interest is written, the rest of the outputs stays zero */
+    if (paramFF->config.roi.width)
+    {
+        memset(paramFF->gaussianOutputImg, 0, paramFF->rows * paramFF->cols * paramFF->pixelBytes);
+        memset(paramFF->enhancedOutputImg, 0, paramFF->rows * paramFF->cols * paramFF->pixelBytes);
+    }
+
+    if (paramFF->config.useImage)
+    {
+        cl_image_format imageFormat;
+        imageFormat.image_channel_order = CL_R;
+        imageFormat.image_channel_data_type = (bitWidth == 8) ? CL_UNSIGNED_INT8 : CL_UNSIGNED_INT16;
+
+        cl_image_desc imageDesc;
+        memset(&imageDesc, 0, sizeof(cl_image_desc));
+        imageDesc.image_type = CL_MEM_OBJECT_IMAGE2D;
+        imageDesc.image_width = paramFF->cols;
+        imageDesc.image_height = paramFF->rows;
+
+        paramFF->mem.input = clCreateImage(infoDeviceOcl->mCtx,
+                        CL_MEM_READ_ONLY | (zeroCopy ? CL_MEM_USE_HOST_PTR : 0),
+                        &imageFormat, &imageDesc, zeroCopy ? paramFF->inputImg : NULL, &err);
+        CHECK_RESULT(err != CL_SUCCESS, "clCreateImage failed with %d\n", err);
+    }
+
     if (zeroCopy)
     {
-        paramFF->input = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-                            paddedRows * paddedCols * sizeof(cl_uchar) * (bitWidth / 8), 
-                            paramFF->inputImg, &err);
+        if (!paramFF->config.useImage)
+        {
+            paramFF->mem.input = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+                                inputBytes, inputHostPtr, &err);
+            CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+        }
+
+        paramFF->mem.filterCoeff = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+            paramFF->filterSize * paramFF->filterSize * sizeof(cl_float), filterCoeffCpu, &err);
         CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
 
-        paramFF->gaussianFilter = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
-            paramFF->filterSize * paramFF->filterSize * sizeof(cl_float), paramFF->gaussianFilterCpu, &err);
+        /* An output that is not selected gets no buffer, its kernel argument is NULL */
+        if (gaussianOutputNeeded(&paramFF->config))
+        {
+            paramFF->mem.gaussianOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR,
+                            paramFF->config.frames * paramFF->rows * paramFF->cols * sizeof(cl_uchar)
+                                            * paramFF->pixelBytes, paramFF->gaussianOutputImg, &err);
+            CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+        }
+
+        if (paramFF->config.outputSelect != OUTPUT_GAUSSIAN)
+        {
+            paramFF->mem.enhancedOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR,
+                            paramFF->config.frames * paramFF->rows * paramFF->cols * sizeof(cl_uchar)
+                                            * paramFF->pixelBytes, paramFF->enhancedOutputImg, &err);
+            CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+        }
+
+        paramFF->mem.filterCoeff1D = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+            paramFF->filterSize * sizeof(cl_float), paramFF->gaussianFilter1DCpu, &err);
         CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+    }
+    else
+    {
+        if (!paramFF->config.useImage)
+        {
+            paramFF->mem.input = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY,
+                                inputBytes, NULL, &err);
+            CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+        }
 
-        paramFF->gaussianOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR,
-                        paramFF->rows * paramFF->cols * sizeof(cl_uchar)
-                                        * (bitWidth / 8), paramFF->gaussianOutputImg, &err);
+        /* Coefficients do not change between runs, upload them once here */
+        paramFF->mem.filterCoeff = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                        paramFF->filterSize * paramFF->filterSize * sizeof(cl_float),
+                        filterCoeffCpu, &err);
         CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
 
-        paramFF->enhancedOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR,
-                        paramFF->rows * paramFF->cols * sizeof(cl_uchar)
-                                        * (bitWidth / 8), paramFF->enhancedOutputImg, &err);
+        if (gaussianOutputNeeded(&paramFF->config))
+        {
+            paramFF->mem.gaussianOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_WRITE_ONLY,
+                            paramFF->config.frames * paramFF->rows * paramFF->cols * sizeof(cl_uchar)
+                                            * paramFF->pixelBytes, NULL, &err);
+            CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+        }
+
+        if (paramFF->config.outputSelect != OUTPUT_GAUSSIAN)
+        {
+            paramFF->mem.enhancedOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_WRITE_ONLY,
+                            paramFF->config.frames * paramFF->rows * paramFF->cols * sizeof(cl_uchar)
+                                            * paramFF->pixelBytes, NULL, &err);
+            CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+        }
+
+        paramFF->mem.filterCoeff1D = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                        paramFF->filterSize * sizeof(cl_float), paramFF->gaussianFilter1DCpu, &err);
         CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
     }
-    else
+
+    /**************************************************************************
+    * Horizontal pass output of the separable, recursive and box filters;
+    * never leaves the device
+    ***************************************************************************/
+    if (paramFF->config.filterMode == FILTER_MODE_SEPARABLE ||
+        paramFF->config.filterMode == FILTER_MODE_RECURSIVE ||
+        paramFF->config.filterMode == FILTER_MODE_BOX)
     {
-        paramFF->input = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY,
-                            paddedRows * paddedCols * sizeof(cl_uchar) * (bitWidth / 8), 
-                            NULL, &err);
+        paramFF->mem.rowOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_WRITE,
+                        paddedRows * paramFF->cols * sizeof(cl_float), NULL, &err);
         CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+    }
 
-        paramFF->gaussianFilter = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY,
-                        paramFF->filterSize * paramFF->filterSize * sizeof(cl_float), NULL, &err);
+    if (paramFF->config.filterMode == FILTER_MODE_BOX)
+    {
+        paramFF->mem.boxTemp = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_WRITE,
+                        paramFF->rows * paramFF->cols * sizeof(cl_float), NULL, &err);
         CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+    }
 
-        paramFF->gaussianOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_WRITE_ONLY,
-                        paramFF->rows * paramFF->cols * sizeof(cl_uchar)
-                                        * (bitWidth / 8), NULL, &err);
+    /**************************************************************************
+    * All pyramid levels share one buffer, allocated once here
+    ***************************************************************************/
+    paramFF->pyramidImg = NULL;
+    computePyramidLayout(paramFF->cols, paramFF->rows, paramFF->config.pyramidLevels,
+                    &(paramFF->pyramid));
+    if (paramFF->config.pyramidLevels)
+    {
+        paramFF->pyramidImg = (cl_uchar *) malloc(paramFF->pyramid.size * paramFF->pixelBytes);
+        CHECK_RESULT(paramFF->pyramidImg == NULL, "Malloc failed.\n");
+
+        paramFF->mem.pyramid = clCreateBuffer(infoDeviceOcl->mCtx,
+                        CL_MEM_READ_WRITE | (zeroCopy ? CL_MEM_USE_HOST_PTR : 0),
+                        paramFF->pyramid.size * paramFF->pixelBytes,
+                        zeroCopy ? paramFF->pyramidImg : NULL, &err);
         CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+    }
 
-        paramFF->enhancedOutput = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_WRITE_ONLY,
-                        paramFF->rows * paramFF->cols * sizeof(cl_uchar)
-                                        * (bitWidth / 8), NULL, &err);
+    /**************************************************************************
+    * Summed-area table and box mean output. The radius map does not change
+    * between runs and is uploaded once here
+    ***************************************************************************/
+    paramFF->boxMeanImg = NULL;
+    if (paramFF->config.satRadius)
+    {
+        paramFF->boxMeanImg = (cl_uchar *) malloc(paramFF->rows * paramFF->cols * paramFF->pixelBytes);
+        CHECK_RESULT(paramFF->boxMeanImg == NULL, "Malloc failed.\n");
+
+        paramFF->mem.sat = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_WRITE,
+                        paramFF->rows * paramFF->cols * (satIsWide(&paramFF->config) ? sizeof(cl_ulong) : sizeof(cl_uint)),
+                        NULL, &err);
+        CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+
+        paramFF->mem.boxMeanOutput = clCreateBuffer(infoDeviceOcl->mCtx,
+                        CL_MEM_WRITE_ONLY | (zeroCopy ? CL_MEM_USE_HOST_PTR : 0),
+                        paramFF->rows * paramFF->cols * paramFF->pixelBytes,
+                        zeroCopy ? paramFF->boxMeanImg : NULL, &err);
+        CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+
+        if (paramFF->config.radiusMap)
+        {
+            paramFF->mem.radiusMap = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                            paramFF->rows * paramFF->cols, paramFF->radiusMapImg, &err);
+            CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+        }
+    }
+
+    /* Zeroed once, the persistent kernel resets it at the end of every launch */
+    if (paramFF->config.persistent)
+    {
+        cl_uint zero[2] = { 0, 0 };
+        paramFF->mem.tileCounter = clCreateBuffer(infoDeviceOcl->mCtx,
+                        CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(zero), zero, &err);
+        CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
+    }
+
+    /* Collapsed Laplacian levels never leave the device */
+    if (paramFF->config.multiScale)
+    {
+        paramFF->mem.collapse = clCreateBuffer(infoDeviceOcl->mCtx, CL_MEM_READ_WRITE,
+                        paramFF->pyramid.size * sizeof(cl_float), NULL, &err);
         CHECK_RESULT(err != CL_SUCCESS, "clCreateBuffer failed with %d\n", err);
     }
 
@@ -805,12 +1940,490 @@ bool createMemory(filters* paramFF, DeviceInfo *infoDeviceOcl,
 void destroyMemory(filters* paramFF, DeviceInfo *infoDeviceOcl)
 {
     free(paramFF->inputImg);
+    free(paramFF->packedImg);
     free(paramFF->gaussianOutputImg);
     free(paramFF->enhancedOutputImg);
+    free(paramFF->gaussianFilterCpu);
+    free(paramFF->gaussianFilter1DCpu);
+    free(paramFF->gaussianFilterFixedCpu);
+    free(paramFF->pyramidImg);
+    free(paramFF->radiusMapImg);
+    free(paramFF->boxMeanImg);
     
-    clReleaseMemObject(paramFF->input);
-    clReleaseMemObject(paramFF->gaussianFilter);
-    clReleaseMemObject(paramFF->gaussianOutput);
-    clReleaseMemObject(paramFF->enhancedOutput);
-    clReleaseKernel(paramFF->gaussianKernel);
-}
\ No newline at end of file
+    clReleaseMemObject(paramFF->mem.input);
+    clReleaseMemObject(paramFF->mem.filterCoeff);
+    if (paramFF->mem.gaussianOutput)
+        clReleaseMemObject(paramFF->mem.gaussianOutput);
+    if (paramFF->mem.enhancedOutput)
+        clReleaseMemObject(paramFF->mem.enhancedOutput);
+    clReleaseMemObject(paramFF->mem.filterCoeff1D);
+    if (paramFF->mem.rowOutput)
+        clReleaseMemObject(paramFF->mem.rowOutput);
+    if (paramFF->mem.pyramid)
+        clReleaseMemObject(paramFF->mem.pyramid);
+    if (paramFF->mem.collapse)
+        clReleaseMemObject(paramFF->mem.collapse);
+    if (paramFF->mem.tileCounter)
+        clReleaseMemObject(paramFF->mem.tileCounter);
+    if (paramFF->mem.boxTemp)
+        clReleaseMemObject(paramFF->mem.boxTemp);
+    if (paramFF->mem.sat)
+        clReleaseMemObject(paramFF->mem.sat);
+    if (paramFF->mem.radiusMap)
+        clReleaseMemObject(paramFF->mem.radiusMap);
+    if (paramFF->mem.boxMeanOutput)
+        clReleaseMemObject(paramFF->mem.boxMeanOutput);
+    releaseKernels(&(paramFF->kernels));
+}
+
+/**
+ *******************************************************************************
+ *  @fn     borderIndex
+ *  @brief  This function maps a coordinate up to one image size outside [0, n)
+ *          the way the border kernels do. Zero border coordinates are returned
+ *          unchanged, the caller skips them
+ *
+ *  @param[in] x                : coordinate
+ *  @param[in] n                : image size along the coordinate
+ *  @param[in] borderMode       : BORDER_MODE_*
+ *
+ *  @return cl_int : coordinate to read
+ *******************************************************************************
+ */
+static cl_int borderIndex(cl_int x, cl_int n, cl_int borderMode)
+{
+    if (x >= 0 && x < n)
+        return x;
+
+    switch (borderMode)
+    {
+    case BORDER_MODE_REPLICATE:
+        return x < 0 ? 0 : n - 1;
+    case BORDER_MODE_REFLECT:
+        return x < 0 ? -x - 1 : 2 * n - x - 1;
+    case BORDER_MODE_WRAP:
+        return x < 0 ? x + n : x - n;
+    default:
+        return x;
+    }
+}
+
+/**
+ *******************************************************************************
+ *  @fn     exactGaussianReference
+ *  @brief  This function filters one channel of the input in float with the
+ *          exact Gaussian of sigma over a radius of 4 sigma, in a row and a
+ *          column pass. Lines are extended by replicating the edge pixel, as
+ *          the recursive and box filters do
+ *
+ *  @param[in] paramFF          : pointer to filters structure
+ *  @param[in] channel          : channel to filter
+ *  @param[in] bitWidth         : bits per input pixel
+ *  @param[out] ref             : cols x rows filtered pixels
+ *
+ *  @return bool : true if successful; otherwise false.
+ *******************************************************************************
+ */
+static bool exactGaussianReference(filters *paramFF, cl_uint channel, cl_uint bitWidth, cl_float *ref)
+{
+    cl_int cols = paramFF->cols;
+    cl_int rows = paramFF->rows;
+    cl_int pad = (paramFF->paddedCols - paramFF->cols) / 2;
+    cl_int radius = (cl_int)ceil(4.0f * paramFF->config.sigma);
+    cl_uint size = 2 * radius + 1;
+
+    cl_float *coeff1D = (cl_float *) malloc(size * sizeof(cl_float));
+    cl_float *coeff2D = (cl_float *) malloc(size * size * sizeof(cl_float));
+    cl_float *rowPass = (cl_float *) malloc(cols * rows * sizeof(cl_float));
+    if (coeff1D == NULL || coeff2D == NULL || rowPass == NULL)
+    {
+        free(coeff1D);
+        free(coeff2D);
+        free(rowPass);
+        CHECK_RESULT(true, "Malloc failed.\n");
+    }
+    generateGaussianCoeff(size, paramFF->config.sigma, coeff1D, coeff2D);
+
+    for (cl_int i = 0; i < rows; i++)
+    {
+        for (cl_int j = 0; j < cols; j++)
+        {
+            cl_float sum = 0.0f;
+            for (cl_int k = -radius; k <= radius; k++)
+            {
+                cl_int col = j + k < 0 ? 0 : (j + k >= cols ? cols - 1 : j + k);
+                size_t pos = sampleIndex(&paramFF->config, channel, col + pad, i + pad,
+                                paramFF->paddedCols, paramFF->paddedRows);
+                cl_float pix = (bitWidth == 8) ? paramFF->inputImg[pos] :
+                                ((cl_ushort *)paramFF->inputImg)[pos];
+                sum += pix * coeff1D[k + radius];
+            }
+            rowPass[i * cols + j] = sum;
+        }
+    }
+
+    for (cl_int i = 0; i < rows; i++)
+    {
+        for (cl_int j = 0; j < cols; j++)
+        {
+            cl_float sum = 0.0f;
+            for (cl_int k = -radius; k <= radius; k++)
+            {
+                cl_int row = i + k < 0 ? 0 : (i + k >= rows ? rows - 1 : i + k);
+                sum += rowPass[row * cols + j] * coeff1D[k + radius];
+            }
+            ref[i * cols + j] = sum;
+        }
+    }
+
+    free(coeff1D);
+    free(coeff2D);
+    free(rowPass);
+    return true;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     verifyOutput
+ *  @brief  This function runs the non-separable filter in float on the CPU and
+ *          reports how far the Gaussian output of the last run is from it. In
+ *          separable mode the filter is the outer product of the 1D taps the
+ *          passes use, the shipped 2D tables are not always one. The recursive
+ *          and box filters approximate the Gaussian of sigma and are compared
+ *          with the exact one, see exactGaussianReference
+ *
+ *  @param[in] paramFF          : pointer to filters structure
+ *  @param[in] bitWidth         : 8 bit or 16 bit input
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void verifyOutput(filters *paramFF, cl_uint bitWidth)
+{
+    cl_uint filterSize = paramFF->filterSize;
+    cl_int offset = (paramFF->filterSize - 1 - (paramFF->paddedCols - paramFF->cols)) / 2;
+    cl_float maxVal = (cl_float)((1u << bitWidth) - 1);
+    cl_uint maxErr = 0;
+    double sumErr = 0.0;
+    cl_int separable = (paramFF->config.filterMode == FILTER_MODE_SEPARABLE);
+    const cl_float *filter1D = paramFF->gaussianFilter1DCpu;
+
+    /* Only the region of interest is read back */
+    roiRect rect = { 0, 0, paramFF->cols, paramFF->rows };
+    if (paramFF->config.roi.width)
+        rect = paramFF->config.roi;
+
+    cl_float *exactRef = NULL;
+    if (paramFF->config.filterMode == FILTER_MODE_RECURSIVE || paramFF->config.filterMode == FILTER_MODE_BOX)
+    {
+        exactRef = (cl_float *) malloc(paramFF->cols * paramFF->rows * sizeof(cl_float));
+        if (exactRef == NULL)
+        {
+            printf("Malloc failed, the output is not verified.\n");
+            return;
+        }
+    }
+
+    for (cl_uint c = 0; c < paramFF->config.channels; c++)
+    {
+        if (exactRef && !exactGaussianReference(paramFF, c, bitWidth, exactRef))
+        {
+            free(exactRef);
+            return;
+        }
+
+        for (cl_uint i = rect.y; i < rect.y + rect.height; i++)
+        {
+            for (cl_uint j = rect.x; j < rect.x + rect.width; j++)
+            {
+                cl_float sum = exactRef ? exactRef[i * paramFF->cols + j] : 0.0f;
+                for (cl_uint y = 0; !exactRef && y < filterSize; y++)
+                {
+                    for (cl_uint x = 0; x < filterSize; x++)
+                    {
+                        /* Samples outside the stored input follow the border mode */
+                        cl_int row = borderIndex(i + y - offset, paramFF->paddedRows, paramFF->config.borderMode);
+                        cl_int col = borderIndex(j + x - offset, paramFF->paddedCols, paramFF->config.borderMode);
+                        if (row < 0 || col < 0 || row >= (cl_int)paramFF->paddedRows || col >= (cl_int)paramFF->paddedCols)
+                            continue;
+
+                        size_t pos = sampleIndex(&paramFF->config, c, col, row,
+                                        paramFF->paddedCols, paramFF->paddedRows);
+                        cl_float pix = (bitWidth == 8) ? paramFF->inputImg[pos] :
+                                        ((cl_ushort *)paramFF->inputImg)[pos];
+                        sum += pix * (separable ? filter1D[y] * filter1D[x] :
+                                        paramFF->gaussianFilterCpu[y * filterSize + x]);
+                    }
+                }
+                sum = sum > maxVal ? maxVal : (sum < 0.0f ? 0.0f : sum);
+
+                cl_int ref = (cl_int)rint(sum);
+                size_t outPos = sampleIndex(&paramFF->config, c, j, i, paramFF->cols, paramFF->rows);
+                cl_int out = (bitWidth == 8) ? paramFF->gaussianOutputImg[outPos] :
+                                ((cl_ushort *)paramFF->gaussianOutputImg)[outPos];
+                cl_uint err = abs(out - ref);
+
+                maxErr = err > maxErr ? err : maxErr;
+                sumErr += err;
+            }
+        }
+    }
+
+    printf("Gaussian output vs CPU float reference%s: max abs error %d, mean abs error %f\n",
+                    exactRef ? " (exact Gaussian)" : "",
+                    maxErr, sumErr / (rect.width * rect.height * paramFF->config.channels));
+    free(exactRef);
+}
+
+/**
+ *******************************************************************************
+ *  @fn     tileSupported
+ *  @brief  This function checks whether a work-group tile fits the device
+ *          limits and, with LDS, the local memory size
+ *
+ *  @param[in] infoDeviceOcl    : pointer to the structure containing opencl
+ *                                device information
+ *  @param[in] config           : filter size, bit width and LDS switch
+ *  @param[in] localXRes        : tile width
+ *  @param[in] localYRes        : tile height
+ *
+ *  @return bool : true if the tile can be used; otherwise false.
+ *******************************************************************************
+ */
+bool tileSupported(DeviceInfo *infoDeviceOcl, filterConfig *config,
+                cl_uint localXRes, cl_uint localYRes)
+{
+    size_t maxGroupSize = 0;
+    size_t maxItemSizes[3] = { 0, 0, 0 };
+    cl_ulong localMemSize = 0;
+
+    clGetDeviceInfo(infoDeviceOcl->mDevice, CL_DEVICE_MAX_WORK_GROUP_SIZE,
+                    sizeof(size_t), &maxGroupSize, NULL);
+    clGetDeviceInfo(infoDeviceOcl->mDevice, CL_DEVICE_MAX_WORK_ITEM_SIZES,
+                    sizeof(maxItemSizes), maxItemSizes, NULL);
+
+    if (localXRes * localYRes > maxGroupSize ||
+        localXRes > maxItemSizes[0] || localYRes > maxItemSizes[1])
+        return false;
+
+    /* Same padded row stride as TILE_STRIDE in the kernels */
+    if (config->useLds == 1)
+    {
+        cl_uint pixPerBank = 32 / config->bitWidth;
+        cl_uint tileXRes = localXRes + config->filtSize - 1;
+        cl_uint tileStride = (((tileXRes + pixPerBank - 1) / pixPerBank) | 1) * pixPerBank;
+        cl_uint tileYRes = localYRes + config->filtSize - 1;
+
+        clGetDeviceInfo(infoDeviceOcl->mDevice, CL_DEVICE_LOCAL_MEM_SIZE,
+                        sizeof(cl_ulong), &localMemSize, NULL);
+        if ((cl_ulong)tileStride * tileYRes * (config->bitWidth / 8) > localMemSize)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     tuneKey
+ *  @brief  This function formats the key under which the tuned tile of the
+ *          current device, kernel configuration and resolution is stored
+ *
+ *  @param[in] infoDeviceOcl    : pointer to the structure containing opencl
+ *                                device information
+ *  @param[in] paramFF          : pointer to filters structure
+ *  @param[out] key             : key without white space
+ *  @param[in] keySize          : size of key in bytes
+ *
+ *  @return void
+ *******************************************************************************
+ */
+static void tuneKey(DeviceInfo *infoDeviceOcl, filters *paramFF, char *key, size_t keySize)
+{
+    char deviceName[256] = "";
+    filterConfig *config = &(paramFF->config);
+
+    clGetDeviceInfo(infoDeviceOcl->mDevice, CL_DEVICE_NAME, sizeof(deviceName) - 1, deviceName, NULL);
+    for (char *c = deviceName; *c; c++)
+        if (*c == ' ' || *c == '\t')
+            *c = '_';
+
+    snprintf(key, keySize, "%s/t%d/b%d/m%d/lds%d/r%d/v%d/c%d/fx%d/img%d/bm%d/fold%d/h%d/ch%d/p%d/ps%d"
+                    "/s%d/bt%d/f%d/o%d/bk%d/roi%d,%d,%d,%d/%dx%d",
+                    deviceName, config->filtSize, config->bitWidth, config->filterMode,
+                    config->useLds, config->rowsPerItem, config->vecWidth,
+                    config->runCombinedKernel, config->fixedPoint, config->useImage,
+                    config->borderMode, config->foldCoeff, config->halfPrecision,
+                    config->channels, config->planar, config->persistent,
+                    config->strip, config->batched, config->frames, config->outputSelect,
+                    config->bakeCoeff, config->roi.x, config->roi.y, config->roi.width,
+                    config->roi.height, paramFF->cols, paramFF->rows);
+}
+
+/**
+ *******************************************************************************
+ *  @fn     loadTunedLocalSize
+ *  @brief  This function looks up the tile stored by an earlier -autotune run
+ *          for this device, configuration and resolution
+ *
+ *  @param[in] infoDeviceOcl    : pointer to the structure containing opencl
+ *                                device information
+ *  @param[in/out] paramFF      : pointer to filters structure, receives the
+ *                                tile in config
+ *
+ *  @return bool : true if a usable tile was found; otherwise false.
+ *******************************************************************************
+ */
+bool loadTunedLocalSize(DeviceInfo *infoDeviceOcl, filters *paramFF)
+{
+    char key[512], lineKey[512];
+    cl_uint localXRes, localYRes;
+    bool found = false;
+
+    FILE *fp = fopen(DEFAULT_TUNE_FILE, "r");
+    if (fp == NULL)
+        return false;
+
+    tuneKey(infoDeviceOcl, paramFF, key, sizeof(key));
+    while (fscanf(fp, "%511s %u %u", lineKey, &localXRes, &localYRes) == 3)
+    {
+        if (strcmp(key, lineKey) == 0 &&
+            tileSupported(infoDeviceOcl, &(paramFF->config), localXRes, localYRes))
+        {
+            paramFF->config.localXRes = localXRes;
+            paramFF->config.localYRes = localYRes;
+            found = true;
+        }
+    }
+    fclose(fp);
+
+    return found;
+}
+
+/**
+ *******************************************************************************
+ *  @fn     storeTunedLocalSize
+ *  @brief  This function stores the tile in config for this device,
+ *          configuration and resolution, replacing an older entry
+ *
+ *  @param[in] infoDeviceOcl    : pointer to the structure containing opencl
+ *                                device information
+ *  @param[in] paramFF          : pointer to filters structure
+ *
+ *  @return void
+ *******************************************************************************
+ */
+void storeTunedLocalSize(DeviceInfo *infoDeviceOcl, filters *paramFF)
+{
+    char key[512], lineKey[512];
+    cl_uint localXRes, localYRes;
+    std::vector<std::string> lines;
+
+    tuneKey(infoDeviceOcl, paramFF, key, sizeof(key));
+
+    FILE *fp = fopen(DEFAULT_TUNE_FILE, "r");
+    if (fp != NULL)
+    {
+        while (fscanf(fp, "%511s %u %u", lineKey, &localXRes, &localYRes) == 3)
+        {
+            if (strcmp(key, lineKey) != 0)
+            {
+                char line[600];
+                snprintf(line, sizeof(line), "%s %u %u", lineKey, localXRes, localYRes);
+                lines.push_back(line);
+            }
+        }
+        fclose(fp);
+    }
+
+    fp = fopen(DEFAULT_TUNE_FILE, "w");
+    if (fp == NULL)
+    {
+        printf("Could not write %s, the tuned tile is not stored.\n", DEFAULT_TUNE_FILE);
+        return;
+    }
+    for (size_t i = 0; i < lines.size(); i++)
+        fprintf(fp, "%s\n", lines[i].c_str());
+    fprintf(fp, "%s %u %u\n", key, paramFF->config.localXRes, paramFF->config.localYRes);
+    fclose(fp);
+}
+
+/**
+ *******************************************************************************
+ *  @fn     autotuneLocalSize
+ *  @brief  This function builds the kernels for every candidate work-group
+ *          tile, times them with profiling events and keeps the fastest in
+ *          config. The choice is stored in DEFAULT_TUNE_FILE for later runs
+ *
+ *  @param[in] infoDeviceOcl    : pointer to the structure containing opencl
+ *                                device information
+ *  @param[in/out] paramFF      : pointer to filters structure, memory must be
+ *                                created
+ *
+ *  @return bool : true if a tile was found; otherwise false.
+ *******************************************************************************
+ */
+bool autotuneLocalSize(DeviceInfo *infoDeviceOcl, filters *paramFF)
+{
+    filterConfig *config = &(paramFF->config);
+    cl_double bestTime = -1.0;
+    cl_uint bestXRes = 0, bestYRes = 0;
+
+    printf("Autotuning the work-group tile:\n");
+
+    for (cl_uint t = 0; t < sizeof(autotuneTiles) / sizeof(autotuneTiles[0]); t++)
+    {
+        filterKernels kernels;
+        kernelEvents events;
+        cl_double time_ms = 0.0;
+
+        config->localXRes = autotuneTiles[t][0];
+        config->localYRes = autotuneTiles[t][1];
+        if (!tileSupported(infoDeviceOcl, config, config->localXRes, config->localYRes))
+            continue;
+
+        if (buildKernels(infoDeviceOcl->mCtx, infoDeviceOcl->mDevice, config, &kernels) == false)
+            continue;
+
+        /* Register or LDS use of a variant can lower its work-group limit */
+        if (kernelsWorkGroupSize(&kernels, infoDeviceOcl->mDevice) < config->localXRes * config->localYRes ||
+            setKernelArgs(&kernels, &(paramFF->mem), config, paramFF->cols, paramFF->rows) == false)
+        {
+            releaseKernels(&kernels);
+            continue;
+        }
+
+        /* Warm-up, then the measured launches */
+        events.count = 0;
+        bool ok = runKernels(infoDeviceOcl->mQueue, &kernels, config, paramFF->cols, paramFF->rows, NULL);
+        clFinish(infoDeviceOcl->mQueue);
+        for (cl_uint i = 0; ok && i < AUTOTUNE_ITERATIONS; i++)
+        {
+            ok = runKernels(infoDeviceOcl->mQueue, &kernels, config, paramFF->cols, paramFF->rows, &events);
+            if (ok)
+                time_ms += kernelEventsTime(&events);
+        }
+        releaseKernels(&kernels);
+        if (!ok)
+            continue;
+
+        time_ms /= AUTOTUNE_ITERATIONS;
+        printf("\t%3dx%-3d: %f msec\n", config->localXRes, config->localYRes, time_ms);
+
+        if (bestTime < 0.0 || time_ms < bestTime)
+        {
+            bestTime = time_ms;
+            bestXRes = config->localXRes;
+            bestYRes = config->localYRes;
+        }
+    }
+
+    CHECK_RESULT(bestTime < 0.0, "No work-group tile could be built and run.\n");
+
+    config->localXRes = bestXRes;
+    config->localYRes = bestYRes;
+    storeTunedLocalSize(infoDeviceOcl, paramFF);
+    printf("Using work-group tile %dx%d, stored in %s\n\n", bestXRes, bestYRes, DEFAULT_TUNE_FILE);
+
+    return true;
+}